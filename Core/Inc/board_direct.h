@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    board_direct.h
+  * @brief   Direct register board bring-up, alternative to the HAL MX_*_Init
+  *          sequence (CMake option BOARD_DIRECT_INIT).
+  ******************************************************************************
+  */
+#ifndef __BOARD_DIRECT_H__
+#define __BOARD_DIRECT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Starts DWT CYCCNT from zero, called first thing in main() in both builds */
+void Board_CycleCounterStart(void);
+
+#ifdef BOARD_DIRECT_INIT
+/* Same clocks, pins, timers and IWDG as HAL_Init/SystemClock_Config/MX_*_Init,
+   written straight to the registers. HAL handles are left in READY state so the
+   runtime HAL calls of app/ keep working. */
+void Board_DirectInit(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOARD_DIRECT_H__ */
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    boot_profile.h
+  * @brief   DWT timestamps of the boot stages, from reset to the first step.
+  ******************************************************************************
+  */
+#ifndef __BOOT_PROFILE_H__
+#define __BOOT_PROFILE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* in boot order, each stamp is taken at the end of its stage */
+typedef enum
+{
+  BOOT_STAGE_HAL_INIT = 0,
+  BOOT_STAGE_CLOCK,
+  BOOT_STAGE_GPIO,
+  BOOT_STAGE_FDCAN,
+  BOOT_STAGE_TIM1,
+  BOOT_STAGE_TIM4,
+  BOOT_STAGE_TIM7,
+  BOOT_STAGE_TIM6,
+  BOOT_STAGE_IWDG,
+  BOOT_STAGE_TIM3,
+  BOOT_STAGE_TIM2,
+  BOOT_STAGE_APP_INIT,
+  BOOT_STAGE_BOARD_INIT,
+  BOOT_STAGE_FIRST_STEP,
+  BOOT_STAGE_DEFERRED_INIT,
+  BOOT_STAGE_COUNT
+} BootStage;
+
+/* CYCCNT per stage, 0 while the stage is not reached. Until BOOT_STAGE_CLOCK the core
+   runs from HSI at 16 MHz, at 170 MHz after it. */
+extern uint32_t boot_stamps[BOOT_STAGE_COUNT];
+
+/* first call per stage wins */
+static inline void BootProfile_Stamp(BootStage stage)
+{
+  if (boot_stamps[stage] == 0U)
+    boot_stamps[stage] = DWT->CYCCNT;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOT_PROFILE_H__ */
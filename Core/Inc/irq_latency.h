@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    irq_latency.h
+  * @brief   Worst-case entry latency of the timer interrupts, measured from the
+  *          timer counter at handler entry.
+  ******************************************************************************
+  */
+#ifndef __IRQ_LATENCY_H__
+#define __IRQ_LATENCY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+typedef enum
+{
+  IRQ_LATENCY_STEP = 0,   /* TIM4 CC2, step pulse */
+  IRQ_LATENCY_TICK,       /* TIM1 update, control tick */
+  IRQ_LATENCY_COUNT
+} IrqLatencySource;
+
+/* in timer ticks, TIM1 and TIM4 count at 1 MHz */
+typedef struct
+{
+  uint32_t last;
+  uint32_t max;
+  uint32_t count;
+} IrqLatency;
+
+extern IrqLatency irq_latency[IRQ_LATENCY_COUNT];
+
+/* ticks since the counter passed event_cnt, upcounting timer */
+static inline uint32_t IrqLatency_TimerAge(const TIM_TypeDef *tim, uint32_t event_cnt)
+{
+  uint32_t cnt = tim->CNT;
+  return cnt >= event_cnt ? cnt - event_cnt : cnt + tim->ARR + 1U - event_cnt;
+}
+
+static inline void IrqLatency_Record(IrqLatencySource src, uint32_t ticks)
+{
+  IrqLatency *l = &irq_latency[src];
+  l->last = ticks;
+  if (ticks > l->max)
+    l->max = ticks;
+  l->count++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IRQ_LATENCY_H__ */
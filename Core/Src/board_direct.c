@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file    board_direct.c
+  * @brief   Direct register board bring-up, mirrors the CubeMX configuration
+  *          of RasterDriver.ioc. Keep both in sync when the .ioc changes.
+  ******************************************************************************
+  */
+#include "board_direct.h"
+#include "boot_profile.h"
+#include "fdcan.h"
+#include "iwdg.h"
+#include "tim.h"
+
+void Board_CycleCounterStart(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#ifdef BOARD_DIRECT_INIT
+
+#define GPIO_MODE_IN      0U
+#define GPIO_MODE_OUT     1U
+#define GPIO_MODE_AF      2U
+
+static void GPIO_Config(GPIO_TypeDef *port, uint32_t pins, uint32_t mode, uint32_t af)
+{
+  for (uint32_t pos = 0; pos < 16U; pos++)
+  {
+    if ((pins & (1UL << pos)) == 0U)
+      continue;
+    if (mode == GPIO_MODE_AF)
+    {
+      MODIFY_REG(port->AFR[pos >> 3U], 0xFUL << ((pos & 7U) * 4U), af << ((pos & 7U) * 4U));
+    }
+    /* push-pull, low speed, no pull: same as every pin of the .ioc */
+    CLEAR_BIT(port->OTYPER, 1UL << pos);
+    CLEAR_BIT(port->OSPEEDR, 3UL << (pos * 2U));
+    CLEAR_BIT(port->PUPDR, 3UL << (pos * 2U));
+    MODIFY_REG(port->MODER, 3UL << (pos * 2U), mode << (pos * 2U));
+  }
+}
+
+static void TIM_Base(TIM_HandleTypeDef *htim, TIM_TypeDef *tim, uint32_t psc, uint32_t arr, uint32_t arpe)
+{
+  tim->CR1 = arpe;
+  tim->ARR = arr;
+  tim->PSC = psc;
+  if (IS_TIM_REPETITION_COUNTER_INSTANCE(tim))
+    tim->RCR = 0;
+  tim->EGR = TIM_EGR_UG;
+  tim->SR = 0;
+
+  htim->Instance = tim;
+  htim->Init.Prescaler = psc;
+  htim->Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim->Init.Period = arr;
+  htim->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim->Init.RepetitionCounter = 0;
+  htim->Init.AutoReloadPreload = arpe;
+  htim->Lock = HAL_UNLOCKED;
+  htim->DMABurstState = HAL_DMA_BURST_STATE_READY;
+  TIM_CHANNEL_STATE_SET_ALL(htim, HAL_TIM_CHANNEL_STATE_READY);
+  TIM_CHANNEL_N_STATE_SET_ALL(htim, HAL_TIM_CHANNEL_STATE_READY);
+  htim->State = HAL_TIM_STATE_READY;
+}
+
+static void IRQ_Enable(IRQn_Type irq)
+{
+  NVIC_SetPriority(irq, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
+  NVIC_EnableIRQ(irq);
+}
+
+static void Clock_Init(void)
+{
+  /* HAL_Init */
+  SET_BIT(FLASH->ACR, FLASH_ACR_ICEN | FLASH_ACR_DCEN);
+  NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+  SET_BIT(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN);
+  SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_PWREN);
+  (void)READ_BIT(RCC->APB1ENR1, RCC_APB1ENR1_PWREN);
+  SET_BIT(PWR->CR3, PWR_CR3_UCPD_DBDIS);
+  BootProfile_Stamp(BOOT_STAGE_HAL_INIT);
+
+  /* range 1 boost for 170 MHz */
+  CLEAR_BIT(PWR->CR5, PWR_CR5_R1MODE);
+  while (READ_BIT(PWR->SR2, PWR_SR2_VOSF) != 0U);
+
+  SET_BIT(RCC->CSR, RCC_CSR_LSION);
+  while (READ_BIT(RCC->CSR, RCC_CSR_LSIRDY) == 0U);
+
+  /* HSI 16 MHz / 4 * 85 / 2 = 170 MHz */
+  WRITE_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLSRC_HSI
+                        | ((4U - 1U) << RCC_PLLCFGR_PLLM_Pos)
+                        | (85U << RCC_PLLCFGR_PLLN_Pos)
+                        | (2U << RCC_PLLCFGR_PLLPDIV_Pos)
+                        | RCC_PLLCFGR_PLLREN);
+  SET_BIT(RCC->CR, RCC_CR_PLLON);
+  while (READ_BIT(RCC->CR, RCC_CR_PLLRDY) == 0U);
+
+  MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, FLASH_LATENCY_4);
+  while (READ_BIT(FLASH->ACR, FLASH_ACR_LATENCY) != FLASH_LATENCY_4);
+
+  /* above 80 MHz the switch goes through HCLK / 2 for 1 us, as HAL_RCC_ClockConfig does */
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE, RCC_CFGR_HPRE_DIV2);
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+  while (READ_BIT(RCC->CFGR, RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+  for (volatile uint32_t i = 0; i < 100U; i++);
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2, RCC_CFGR_HPRE_DIV1);
+  SystemCoreClock = 170000000U;
+
+  MODIFY_REG(RCC->CCIPR, RCC_CCIPR_FDCANSEL, RCC_CCIPR_FDCANSEL_1);
+
+  HAL_InitTick(TICK_INT_PRIORITY);
+  BootProfile_Stamp(BOOT_STAGE_CLOCK);
+}
+
+static void GPIO_Init(void)
+{
+  SET_BIT(RCC->AHB2ENR, RCC_AHB2ENR_GPIOAEN | RCC_AHB2ENR_GPIOBEN | RCC_AHB2ENR_GPIOFEN);
+  (void)READ_BIT(RCC->AHB2ENR, RCC_AHB2ENR_GPIOAEN);
+
+  GPIOA->BRR = INDICATION_0_OUT_Pin | INDICATION_1_OUT_Pin;
+  GPIOB->BRR = NOTUSED_1_OUT_Pin | NOTUSED_0_OUT_Pin | RESET_Pin | CURRENT_WIND_Pin | DIR_Pin;
+  ENABLE_GPIO_Port->BSRR = ENABLE_Pin;
+
+  GPIO_Config(NOTUSED_1_IN_GPIO_Port, NOTUSED_1_IN_Pin, GPIO_MODE_IN, 0);
+  GPIO_Config(GPIOA, CONFIG_3_Pin | CONFIG_2_Pin | CONFIG_1_Pin | EXP_REQ_IN_Pin
+                   | GRID_INFIELD_DETECT_Pin | GRID_HOME_DETECT_Pin | NOTUSED_0_IN_Pin
+                   | GRID_BUTTON_Pin | NOTUSED_PUSHBUTTON_Pin, GPIO_MODE_IN, 0);
+  GPIO_Config(GPIOA, INDICATION_0_OUT_Pin | INDICATION_1_OUT_Pin, GPIO_MODE_OUT, 0);
+  GPIO_Config(GPIOB, NOTUSED_1_OUT_Pin | NOTUSED_0_OUT_Pin | RESET_Pin | ENABLE_Pin
+                   | CURRENT_WIND_Pin | DIR_Pin, GPIO_MODE_OUT, 0);
+  GPIO_Config(IN_MOTION_OUT_GPIO_Port, IN_MOTION_OUT_Pin, GPIO_MODE_AF, GPIO_AF1_TIM2);
+  GPIO_Config(STEP_GPIO_Port, STEP_Pin, GPIO_MODE_AF, GPIO_AF2_TIM4);
+}
+
+static void TIM_Init(void)
+{
+  SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM1EN);
+  SET_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM2EN | RCC_APB1ENR1_TIM3EN | RCC_APB1ENR1_TIM4EN
+                       | RCC_APB1ENR1_TIM6EN | RCC_APB1ENR1_TIM7EN);
+  (void)READ_BIT(RCC->APB1ENR1, RCC_APB1ENR1_TIM2EN);
+
+  /* 1 kHz board update */
+  TIM_Base(&htim1, TIM1, 170U - 1U, 999U, TIM_AUTORELOAD_PRELOAD_DISABLE);
+  IRQ_Enable(TIM1_UP_TIM16_IRQn);
+  BootProfile_Stamp(BOOT_STAGE_TIM1);
+
+  /* 1 MHz motion clock, CH1 drives IN_MOTION_OUT */
+  TIM_Base(&htim2, TIM2, 170U - 1U, 0xFFFFFFFFU, TIM_AUTORELOAD_PRELOAD_DISABLE);
+  MODIFY_REG(TIM2->CCMR1, TIM_CCMR1_OC1M | TIM_CCMR1_CC1S, TIM_OCMODE_FORCED_INACTIVE);
+  CLEAR_BIT(TIM2->CCER, TIM_CCER_CC1P);
+  TIM2->CCR1 = 0;
+  BootProfile_Stamp(BOOT_STAGE_TIM2);
+
+  TIM_Base(&htim3, TIM3, 1700U - 1U, 9999U, TIM_AUTORELOAD_PRELOAD_DISABLE);
+  IRQ_Enable(TIM3_IRQn);
+  BootProfile_Stamp(BOOT_STAGE_TIM3);
+
+  /* step PWM on CH2 */
+  TIM_Base(&htim4, TIM4, 170U - 1U, 999U, TIM_AUTORELOAD_PRELOAD_ENABLE);
+  MODIFY_REG(TIM4->CCMR1, TIM_CCMR1_OC2M | TIM_CCMR1_CC2S | TIM_CCMR1_OC2FE,
+             (TIM_OCMODE_PWM1 << 8U) | TIM_CCMR1_OC2PE);
+  CLEAR_BIT(TIM4->CCER, TIM_CCER_CC2P);
+  TIM4->CCR2 = 499U;
+  IRQ_Enable(TIM4_IRQn);
+  BootProfile_Stamp(BOOT_STAGE_TIM4);
+
+  TIM_Base(&htim6, TIM6, 17000U - 1U, 100U, TIM_AUTORELOAD_PRELOAD_DISABLE);
+  IRQ_Enable(TIM6_DAC_IRQn);
+  BootProfile_Stamp(BOOT_STAGE_TIM6);
+
+  TIM_Base(&htim7, TIM7, 17000U - 1U, 1999U, TIM_AUTORELOAD_PRELOAD_DISABLE);
+  SET_BIT(TIM7->CR1, TIM_CR1_OPM);
+  IRQ_Enable(TIM7_IRQn);
+  BootProfile_Stamp(BOOT_STAGE_TIM7);
+}
+
+static void IWDG_Init(void)
+{
+  hiwdg.Instance = IWDG;
+  hiwdg.Init.Prescaler = IWDG_PRESCALER_4;
+  hiwdg.Init.Window = 4095;
+  hiwdg.Init.Reload = 4095;
+
+  IWDG->KR = 0x0000CCCCU;
+  IWDG->KR = 0x00005555U;
+  IWDG->PR = IWDG_PRESCALER_4;
+  IWDG->RLR = 4095U;
+  while (IWDG->SR != 0U);
+  /* window equals the reset value, a refresh reloads the counter */
+  IWDG->KR = 0x0000AAAAU;
+  BootProfile_Stamp(BOOT_STAGE_IWDG);
+}
+
+void Board_DirectInit(void)
+{
+  Clock_Init();
+  GPIO_Init();
+  /* message RAM layout is private to the HAL driver, keep its init */
+  MX_FDCAN1_Init();
+  TIM_Init();
+  IWDG_Init();
+}
+
+#endif /* BOARD_DIRECT_INIT */
@@ -0,0 +1,9 @@
+/**
+  ******************************************************************************
+  * @file    boot_profile.c
+  * @brief   Storage of the boot stage timestamps, see boot_profile.h
+  ******************************************************************************
+  */
+#include "boot_profile.h"
+
+uint32_t boot_stamps[BOOT_STAGE_COUNT];
@@ -21,6 +21,7 @@
 #include "fdcan.h"
 
 /* USER CODE BEGIN 0 */
+#include "boot_profile.h"
 
 /* USER CODE END 0 */
 
@@ -31,6 +32,7 @@ void MX_FDCAN1_Init(void)
 {
 
   /* USER CODE BEGIN FDCAN1_Init 0 */
+  BootProfile_Stamp(BOOT_STAGE_GPIO);
 
   /* USER CODE END FDCAN1_Init 0 */
 
@@ -52,7 +54,7 @@ void MX_FDCAN1_Init(void)
   hfdcan1.Init.DataSyncJumpWidth = 1;
   hfdcan1.Init.DataTimeSeg1 = 1;
   hfdcan1.Init.DataTimeSeg2 = 1;
-  hfdcan1.Init.StdFiltersNbr = 0;
+  hfdcan1.Init.StdFiltersNbr = 1;
   hfdcan1.Init.ExtFiltersNbr = 0;
   hfdcan1.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
   if (HAL_FDCAN_Init(&hfdcan1) != HAL_OK)
@@ -60,6 +62,7 @@ void MX_FDCAN1_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN FDCAN1_Init 2 */
+  BootProfile_Stamp(BOOT_STAGE_FDCAN);
 
   /* USER CODE END FDCAN1_Init 2 */
 
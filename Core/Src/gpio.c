@@ -49,7 +49,7 @@ void MX_GPIO_Init(void)
   __HAL_RCC_GPIOB_CLK_ENABLE();
 
   /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(GPIOA, INDICATION_0_OUT_Pin|INDICATION_1_OUT_Pin|IN_MOTION_OUT_Pin, GPIO_PIN_RESET);
+  HAL_GPIO_WritePin(GPIOA, INDICATION_0_OUT_Pin|INDICATION_1_OUT_Pin, GPIO_PIN_RESET);
 
   /*Configure GPIO pin Output Level */
   HAL_GPIO_WritePin(GPIOB, NOTUSED_1_OUT_Pin|NOTUSED_0_OUT_Pin|RESET_Pin|CURRENT_WIND_Pin
@@ -65,26 +65,22 @@ void MX_GPIO_Init(void)
   HAL_GPIO_Init(NOTUSED_1_IN_GPIO_Port, &GPIO_InitStruct);
 
   /*Configure GPIO pins : PAPin PAPin PAPin PAPin
-                           PAPin PAPin PAPin */
+                           PAPin PAPin PAPin PAPin
+                           PAPin */
   GPIO_InitStruct.Pin = CONFIG_3_Pin|CONFIG_2_Pin|CONFIG_1_Pin|EXP_REQ_IN_Pin
-                          |GRID_INFIELD_DETECT_Pin|GRID_HOME_DETECT_Pin|NOTUSED_0_IN_Pin;
+                          |GRID_BUTTON_Pin|GRID_INFIELD_DETECT_Pin|GRID_HOME_DETECT_Pin|NOTUSED_0_IN_Pin
+                          |NOTUSED_PUSHBUTTON_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
-  /*Configure GPIO pins : PAPin PAPin PAPin */
-  GPIO_InitStruct.Pin = INDICATION_0_OUT_Pin|INDICATION_1_OUT_Pin|IN_MOTION_OUT_Pin;
+  /*Configure GPIO pins : PAPin PAPin */
+  GPIO_InitStruct.Pin = INDICATION_0_OUT_Pin|INDICATION_1_OUT_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
-  /*Configure GPIO pins : PAPin PAPin */
-  GPIO_InitStruct.Pin = GRID_BUTTON_Pin|NOTUSED_PUSHBUTTON_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
-  GPIO_InitStruct.Pull = GPIO_NOPULL;
-  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
-
   /*Configure GPIO pins : PBPin PBPin PBPin PBPin
                            PBPin PBPin */
   GPIO_InitStruct.Pin = NOTUSED_1_OUT_Pin|NOTUSED_0_OUT_Pin|RESET_Pin|ENABLE_Pin
@@ -94,13 +90,6 @@ void MX_GPIO_Init(void)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
-  /* EXTI interrupt init*/
-  HAL_NVIC_SetPriority(EXTI9_5_IRQn, 0, 0);
-  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
-
-  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
-  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
-
 }
 
 /* USER CODE BEGIN 2 */
@@ -0,0 +1,9 @@
+/**
+  ******************************************************************************
+  * @file    irq_latency.c
+  * @brief   Storage of the interrupt latency records, see irq_latency.h
+  ******************************************************************************
+  */
+#include "irq_latency.h"
+
+IrqLatency irq_latency[IRQ_LATENCY_COUNT];
@@ -21,6 +21,7 @@
 #include "iwdg.h"
 
 /* USER CODE BEGIN 0 */
+#include "boot_profile.h"
 
 /* USER CODE END 0 */
 
@@ -46,6 +47,7 @@ void MX_IWDG_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN IWDG_Init 2 */
+  BootProfile_Stamp(BOOT_STAGE_IWDG);
 
   /* USER CODE END IWDG_Init 2 */
 
@@ -28,6 +28,8 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "board_direct.h"
+#include "boot_profile.h"
 
 /* USER CODE END Includes */
 
@@ -70,7 +72,15 @@ extern void AppInit();
 int main(void)
 {
   /* USER CODE BEGIN 1 */
-
+  Board_CycleCounterStart();
+#ifdef BOARD_DIRECT_INIT
+  Board_DirectInit();
+  AppInit();
+  while (1)
+  {
+    AppLoop();
+  }
+#endif
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -79,6 +89,7 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
+  BootProfile_Stamp(BOOT_STAGE_HAL_INIT);
 
   /* USER CODE END Init */
 
@@ -86,6 +97,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  BootProfile_Stamp(BOOT_STAGE_CLOCK);
 
   /* USER CODE END SysInit */
 
@@ -98,6 +110,7 @@ int main(void)
   MX_TIM6_Init();
   MX_IWDG_Init();
   MX_TIM3_Init();
+  MX_TIM2_Init();
   /* USER CODE BEGIN 2 */
   AppInit();
   /* USER CODE END 2 */
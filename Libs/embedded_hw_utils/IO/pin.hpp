@@ -0,0 +1,14 @@
+#pragma once
+#include "main.h"
+enum logic_level{ LOW = 0, HIGH = 1 };
+namespace pin_board{
+    struct Readable{}; struct Writeable{};
+    template<typename T>
+    struct PIN{
+        PIN(GPIO_TypeDef* p, uint16_t n): port(p), pin(n){}
+        GPIO_TypeDef* port; uint16_t pin; bool inverted{false};
+        void setInverted(){ inverted = true; }
+        GPIO_PinState getState(){ return GPIO_PinState(HAL_GPIO_ReadPin(port, pin) ^ inverted); }
+        void setValue(logic_level l){ HAL_GPIO_WritePin(port, pin, GPIO_PinState(l)); }
+    };
+}
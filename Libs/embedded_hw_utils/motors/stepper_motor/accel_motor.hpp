@@ -0,0 +1,67 @@
+#pragma once
+#include "main.h"
+#include "tim.h"
+#include "embedded_hw_utils/IO/pin.hpp"
+namespace StepperMotor{
+    enum class Direction{ BACKWARDS, FORWARD };
+    enum Mode{ in_ERROR, ACCEL, DECCEL, CONST };
+    enum Event{ EVENT_NULL, EVENT_CSS, EVENT_STOP };
+    struct StepperCfg{
+        pin_board::PIN<pin_board::Writeable> step, dir, en;
+        TIM_HandleTypeDef* htim; uint32_t channel; uint32_t total_range;
+    };
+}
+namespace MotorSpecial{
+    enum class AccelType{ kLinear, kParabolic, kConstantPower, kSigmoid };
+    struct AccelCfg{
+        float ramp_time; AccelType accel_type; float A; float Vmax; float Vmin;
+        StepperMotor::StepperCfg stepper_cfg;
+    };
+    class AccelMotor{
+    public:
+        explicit AccelMotor(AccelCfg c): cfg_(c){}
+        void UpdateConfig(AccelCfg c){ cfg_ = c; config_Vmax_ = c.Vmax; }
+        void MakeMotorTask(float Vmin, float Vmax, StepperMotor::Direction d, uint32_t steps){
+            dir_ = d; steps_ = steps; done_ = 0;
+            cfg_.stepper_cfg.dir.setValue(d == StepperMotor::Direction::FORWARD ? HIGH : LOW);
+            vmin_ = Vmin > 0 ? Vmin : Vmax; V_ = vmin_; vmax_ = Vmax; accel_steps_ = 0;
+            mode_ = V_ < Vmax ? StepperMotor::ACCEL : StepperMotor::CONST;
+            auto arr = uint32_t(1e6f / (V_ > 0 ? V_ : 1000.f));
+            __HAL_TIM_SET_AUTORELOAD(cfg_.stepper_cfg.htim, arr - 1);
+            __HAL_TIM_SET_COMPARE(cfg_.stepper_cfg.htim, cfg_.stepper_cfg.channel, arr / 2);
+            moving_ = steps > 0;
+            if(moving_) HAL_TIM_PWM_Start_IT(cfg_.stepper_cfg.htim, cfg_.stepper_cfg.channel);
+        }
+        void MotorRefresh(){
+            done_++;
+            float dv = (vmax_ - vmin_) / (cfg_.ramp_time * 20.f + 1.f) * (1.f + cfg_.A / 1000.f);
+            if(mode_ == StepperMotor::ACCEL){ V_ += dv; accel_steps_++; if(V_ >= vmax_){ V_ = vmax_; mode_ = StepperMotor::CONST; } }
+            if(mode_ == StepperMotor::DECCEL || (mode_ != StepperMotor::ACCEL && steps_ - done_ <= accel_steps_ && V_ > vmin_)){ mode_ = StepperMotor::DECCEL; V_ = V_ - dv > vmin_ ? V_ - dv : vmin_; }
+            auto arr = uint32_t(1e6f / V_);
+            __HAL_TIM_SET_AUTORELOAD(cfg_.stepper_cfg.htim, arr - 1);
+            __HAL_TIM_SET_COMPARE(cfg_.stepper_cfg.htim, cfg_.stepper_cfg.channel, arr / 2);
+            AppCorrection(); if(done_ >= steps_) StopMotor(); }
+        uint32_t CurrentStep(){ return done_; }
+        uint32_t StepsToGo(){ return steps_; }
+        void ChangeDirection(){ done_ = 0; dir_ = dir_ == StepperMotor::Direction::FORWARD ? StepperMotor::Direction::BACKWARDS : StepperMotor::Direction::FORWARD; cfg_.stepper_cfg.dir.setValue(dir_ == StepperMotor::Direction::FORWARD ? HIGH : LOW); }
+        void StopMotor(){ moving_ = false; HAL_TIM_PWM_Stop_IT(cfg_.stepper_cfg.htim, cfg_.stepper_cfg.channel); }
+        void SetMode(StepperMotor::Mode m){ mode_ = m; }
+        StepperMotor::Mode CurrentMoveMode(){ return mode_; }
+        StepperMotor::Event GetEvent(){ return StepperMotor::EVENT_NULL; }
+        uint32_t TimeOfAccelPhase(){ return 0; }
+        bool IsMotorMoving(){ return moving_; }
+        void StandByModeOn(){}
+        void SetDirInversion(bool){}
+        uint32_t GetTotalRangeSteps(){ return cfg_.stepper_cfg.total_range; }
+        StepperMotor::Direction CurrentDirection(){ return dir_; }
+        void CorrectStepsToGo(int n){ steps_ = done_ + n; }
+        void CorrectCurrentStep(int){}
+        float CurrentMinSpeed(){ return vmin_; }
+        virtual void AppCorrection(){}
+    protected:
+        AccelCfg cfg_;
+        float V_{0}; float vmin_{1}; float vmax_{1}; uint32_t accel_steps_{0}; StepperMotor::Mode mode_{StepperMotor::CONST};
+        float config_Vmax_{0};
+        StepperMotor::Direction dir_{}; uint32_t steps_{0}, done_{0}; bool moving_{false};
+    };
+}
@@ -0,0 +1,3 @@
+#pragma once
+#define $mSTEPS(x) static_cast<uint32_t>((x) * $DriverMicroStep)
+#define $rampT_(x) float(x)
@@ -4,6 +4,16 @@
 #include "tim.h"
 #include "iwdg.h"
 #include "controller.hpp"
+#include "cycle_counter.hpp"
+#include "deadline_monitor.hpp"
+#include "irq_priorities.hpp"
+#include "motion_clock.hpp"
+#include "refresh_bench.hpp"
+
+// cycles spent in MotorRefresh() per step, compare CCMRAM_EXEC=ON/OFF builds in the debugger
+CycleStats step_isr_cycles;
+// watch in the debugger: < 0 means a step at CONFIG2_MAX_SPEED could have been late
+int32_t step_deadline_margin_usec {0};
 
 extern "C"
 {
@@ -15,48 +25,31 @@ extern "C"
     void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
     {
         if(htim->Instance == TIM1){
+            auto entry = MotionClock::Now();
+            auto start = CycleCounter::Now();
             HAL_IWDG_Refresh(&hiwdg);
             MainController::global().BoardUpdate();
-        }
-        if(htim->Instance == TIM3){
-            MainController::global().UpdateConfig();
-        }
-        if(htim->Instance == TIM6){
-            HAL_TIM_Base_Stop_IT(htim);
-            MainController::global().TimTaskHandler();
-        }
-        if(htim->Instance == TIM7){
-            HAL_TIM_Base_Stop_IT(&htim7);
-            MainController::global().BtnEventHandle();
+            Deadlines::control_tick.Record(CycleCounter::Now() - start, htim->Instance->ARR + 1, entry);
         }
     }
 
     void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim)
     {
         if(htim->Instance == TIM4){
+            auto entry = MotionClock::Now();
+            auto start = CycleCounter::Now();
+            // ARR is preloaded, until MotorRefresh() it is the period running now
+            auto period = htim->Instance->ARR + 1;
+            BootProfile_Stamp(BOOT_STAGE_FIRST_STEP);
             MotorController::global().MotorRefresh();
+            auto cycles = CycleCounter::Now() - start;
+            step_isr_cycles.Add(cycles);
+            Deadlines::step_isr.Record(cycles, period, entry);
         }
     }
 
-    void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
-    {
-        if(GPIO_Pin == GRID_BUTTON_Pin){
-            HAL_GPIO_ReadPin(GRID_BUTTON_GPIO_Port, GRID_BUTTON_Pin) ? HAL_TIM_Base_Start_IT(&htim7)
-                                                                     : HAL_TIM_Base_Stop_IT(&htim7);
-        }
-    }
-
-    void EXTI_clear_enable(){
-        __HAL_GPIO_EXTI_CLEAR_IT(GRID_BUTTON_Pin);
-        NVIC_ClearPendingIRQ(EXTI9_5_IRQn);
-        HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
-    }
-
     void TIM_IT_clear_(){
-        __HAL_TIM_CLEAR_IT(&htim7, TIM_IT_UPDATE);
-        __HAL_TIM_CLEAR_IT(&htim6, TIM_IT_UPDATE);
         __HAL_TIM_CLEAR_IT(&htim4, TIM_IT_UPDATE);
-        __HAL_TIM_CLEAR_IT(&htim3, TIM_IT_UPDATE);
         __HAL_TIM_CLEAR_IT(&htim1, TIM_IT_UPDATE);
     }
 
@@ -65,14 +58,24 @@ extern "C"
     }
 
     void AppInit(){
+        CycleCounter::Init();
+        IrqPriorities::Apply();
+        if constexpr(REFRESH_BENCH)
+            RefreshBench::Run();
+        // construct before any interrupt that reaches global() is enabled
+        MotorController::Create();
+        MainController::Create();
         EnableTimFreezeInBreakpoint();
-        EXTI_clear_enable();
         TIM_IT_clear_();
         HAL_TIM_Base_Start_IT(&htim1);
-        HAL_TIM_Base_Start_IT(&htim3);
+        BootProfile_Stamp(BOOT_STAGE_APP_INIT);
         MainController::global().BoardInit();
+        BootProfile_Stamp(BOOT_STAGE_BOARD_INIT);
     }
 
     void AppLoop()
-    {}
+    {
+        MainController::global().BackgroundTasks();
+        step_deadline_margin_usec = IrqPriorities::StepDeadlineMarginUSec(step_isr_cycles.max);
+    }
 }
\ No newline at end of file
@@ -13,6 +13,9 @@
 #define EXPO_OFFSET_STEPS                   $mSTEPS(9.375)   //steps to run inside park zone (to center expo move)
 #define SWITCH_PRESS_STEPS                  $mSTEPS(3)       //steps to run inside park zone on end of move (ensure not to lose switch while bouncing etc.)
 #define RUN_OUT_STEPS                       $mSTEPS(15)      //steps running out of the parking zone and returning for correct parking
+#define TRAVEL_RANGE_MIN_STEPS              $mSTEPS(400)     //shortest calibrated edge to edge range accepted as valid
+#define SWITCH_APPROACH_STEPS               $mSTEPS(2)       //fast move ends deceleration this far before the calibrated switch edge
+#define SWITCH_MASK_STEPS                   SWITCH_PRESS_STEPS //switch ignored until the grid is this far from where it triggered (stop distance, bounce)
 
 #define INITIAL_SPEED                       $mSTEPS(31.25)   //start speed at every move
 #define CONFIG1_MAX_SPEED                   $mSTEPS(130)     //max speed in acceleration moves
@@ -21,9 +24,10 @@
 #define CONFIG2_RAMP_TIME                   $rampT_(4)      //optimal acceleration phase width multiplier
 #define CONFIG1_ACCELERATION                $mSTEPS(2.5)     //acceleration only for kParabolic
 #define CONFIG2_ACCELERATION                $mSTEPS(3.5)     //acceleration only for kParabolic
+#define PROFILE_MAX_SPEED                   $mSTEPS(200)     //highest Vmax accepted from a flash profile
 
 #define SERVICE_MOVE_MAX_SPEED              $mSTEPS(150)
-#define INIT_MOVE_MAX_SPEED                 $mSTEPS(90)
+#define INIT_MOVE_MAX_SPEED                 $mSTEPS(90)      //service moves too short for the measured ramp to SERVICE_MOVE_MAX_SPEED and back
 
 #define ACCEL_TYPE                      \
                                         MotorSpecial::AccelType::kParabolic
@@ -31,8 +35,22 @@
 //                                      MotorSpecial::AccelType::kConstantPower
 //                                      MotorSpecial::AccelType::kSigmoid
 
-#define IN_MOTION_uSec_DELAY            1000   //time gap in uSec before accel phase end (to set out in_motion sig)
-#define IN_MOTION_mSec_DELAY            (IN_MOTION_uSec_DELAY / 1000)
+#define DIP_DEBOUNCE_TICKS              20     //control ticks (mSec) a DIP switch must be stable before its change is applied
+#define BUTTON_HOLD_TICKS               200    //control ticks (mSec) GRID_BUTTON must be held to start a move
+
+#define FAST_BOOT                       true   //profile table, CAN and telemetry are started from the main loop after the first move is started
+#define TELEMETRY_CAN_ID                0x600  //standard id of the first telemetry message, see CanTelemetry::Msg
+#define COMMAND_CAN_ID                  0x640  //standard id of the first command message, see CanTelemetry::Cmd
+#define REFRESH_BENCH                   false  //time MotorRefresh() per AccelType at boot and report it over CAN, see RefreshBench
+#define INPUT_LOG_SIZE                  256    //raw input edges kept for a CAN dump (power of 2), see InputLog
+#define CONTROL_TICK_BUDGET_PCT         50     //BoardUpdate() longer than this share of the 1 mSec tick is an overrun, see DeadlineMonitor
+#define STEP_ISR_BUDGET_PCT             50     //MotorRefresh() longer than this share of the current step period is an overrun
+#define DEADLINE_STOP_MISSED            3      //control ticks or steps missed in a row (one late invocation) before a safe stop, 0: count only
+#define DEADLINE_STOP_OVERRUNS          0      //overruns in a row of one task before a safe stop, 0: count only
+#define DEADLINE_REPORT_MS              1000   //period of the deadline counters telemetry, 0: off
+
+#define IN_MOTION_uSec_DELAY            1000   //time gap in uSec from exp_req to in_motion sig in scanning mode
+#define IN_MOTION_LEAD_uSec             0      //in_motion sig is set this time before grid reaches expo speed
 
 struct AppCfg{
     MotorSpecial::AccelCfg accelCfg;
@@ -40,7 +58,7 @@ struct AppCfg{
     bool direction_inverted {false};
 };
 
-auto getBaseConfig(){
+inline auto getBaseConfig(){
     static StepperMotor::StepperCfg s_cfg{
             pin_board::PIN<pin_board::Writeable>{STEP_GPIO_Port, STEP_Pin},
             pin_board::PIN<pin_board::Writeable>{DIR_GPIO_Port, DIR_Pin},
@@ -61,28 +79,20 @@ auto getBaseConfig(){
     return appCfg;
 }
 
-auto getDIPConfig(){
-    auto cfg = getBaseConfig();
-    if(HAL_GPIO_ReadPin(CONFIG_1_GPIO_Port, CONFIG_1_Pin)){
-        cfg.accelCfg.Vmax = CONFIG1_MAX_SPEED;
-        cfg.accelCfg.A = CONFIG1_ACCELERATION;
-        cfg.accelCfg.ramp_time = CONFIG1_RAMP_TIME;
-    }else{
-        cfg.accelCfg.Vmax = CONFIG2_MAX_SPEED;
-        cfg.accelCfg.A = CONFIG2_ACCELERATION;
-        cfg.accelCfg.ramp_time = CONFIG2_RAMP_TIME;
-    }
-    cfg.accelCfg.Vmin = INITIAL_SPEED;
-    cfg.oscillation_enabled = HAL_GPIO_ReadPin(CONFIG_2_GPIO_Port, CONFIG_2_Pin);
+struct DIPConfig{
+    uint8_t profile_idx {0};
+    bool oscillation_enabled {false};
 
-    cfg.accelCfg.accel_type = HAL_GPIO_ReadPin(CONFIG_3_GPIO_Port, CONFIG_3_Pin) ? MotorSpecial::AccelType::kParabolic
-                                                                            : MotorSpecial::AccelType::kConstantPower;
-    return cfg;
-}
+    bool operator==(const DIPConfig&) const = default;
+};
 
-void StartTaskTimIT(uint16_t delay){
-    __HAL_TIM_SET_AUTORELOAD(&htim6, delay);
-    HAL_TIM_Base_Start_IT(&htim6);
+// CONFIG_1 selects CONFIG1/CONFIG2 speeds, CONFIG_3 kParabolic/kConstantPower (see ProfileTable::Defaults)
+inline auto getDIPConfig(uint32_t port_state){
+    DIPConfig cfg;
+    cfg.profile_idx = ((port_state & CONFIG_1_Pin) ? 0 : 2)
+                    + ((port_state & CONFIG_3_Pin) ? 0 : 1);
+    cfg.oscillation_enabled = port_state & CONFIG_2_Pin;
+    return cfg;
 }
 
 namespace utils{
@@ -96,7 +106,6 @@ namespace RBTypes{
     enum class Output : std::size_t{
         indication_0 = 1,
         indication_1 = 0,
-        in_motion = 2,
     };
 
     enum class Input : std::size_t{
@@ -109,7 +118,8 @@ namespace RBTypes{
         no_error,
         limit_switch_error,
         initial_movement_error,
-        exp_req_error
+        exp_req_error,
+        deadline_error
     };
 
     enum class State : std::size_t{
@@ -121,14 +131,10 @@ namespace RBTypes{
         oscillation,
         error,
         moving_in_field,
-        moving_home
+        moving_home,
+        calibration
     };
 
-    enum class TimTask : std::size_t{
-        no_task,
-        freeze_switch,
-        in_motion_delay,
-    };
     enum class MoveSpeed : std::size_t{
         slow,
         fast
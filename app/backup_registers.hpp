@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "main.h"
+
+// TAMP backup registers keep their content over system resets (IWDG, NRST, soft reset)
+// while the supply is on. Each value is stored with its complement in the next register.
+class BackupRegisters{
+public:
+    static constexpr uint8_t kMaxKeys = 8;
+
+    static void Init(){
+        __HAL_RCC_PWR_CLK_ENABLE();
+        __HAL_RCC_RTCAPB_CLK_ENABLE();
+        HAL_PWR_EnableBkUpAccess();
+    }
+
+    static std::optional<uint32_t> Read(uint8_t key){
+        if(key >= kMaxKeys)
+            return std::nullopt;
+        auto value = Register(key * 2);
+        if(Register(key * 2 + 1) != ~value)
+            return std::nullopt;
+        return value;
+    }
+
+    static void Write(uint8_t key, uint32_t value){
+        if(key >= kMaxKeys)
+            return;
+        Register(key * 2 + 1) = ~value;
+        Register(key * 2) = value;
+    }
+
+private:
+    static volatile uint32_t& Register(uint8_t idx){
+        return (&TAMP->BKP0R)[idx];
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "fdcan.h"
+#include "boot_profile.h"
+#include "app_config.hpp"
+
+// Telemetry over FDCAN1, classic frames with 8 data bytes, id TELEMETRY_CAN_ID + Msg.
+// Frames are queued in RAM from any context and handed to the 3 element TX FIFO by Flush()
+// from the main loop. Commands, id COMMAND_CAN_ID + Cmd, are the only frames accepted into
+// RX FIFO 0 and are polled by Receive() from the main loop.
+class CanTelemetry{
+public:
+    enum class Msg : uint8_t{
+        boot_stage = 0,     // index: BootStage, value: CYCCNT
+        state = 1,          // index: RBTypes::State, value: absolute position (int32)
+        refresh_bench = 2,  // AccelType, speed set, phase, steps (max 255), avg and max cycles (u16), see RefreshBench
+        input_log = 3,      // u16 sequence, levels and changed bits of PA6..PA9, u32 MotionClock time, see InputLog
+        deadline = 4,       // task, max load %, u16 max uSec, overruns and missed ticks, see DeadlineMonitor
+        profile = 5,        // index: ProfileTable entry swapped in, value: 0
+    };
+
+    enum class Cmd : uint8_t{
+        select_profile = 0, // byte 0: ProfileTable entry, overrides the DIP switches until reboot
+        count
+    };
+
+    using Payload = std::array<uint8_t, 8>;
+
+    struct Command{
+        Cmd cmd;
+        Payload data;
+    };
+
+    void Init(){
+        FDCAN_FilterTypeDef commands{
+            .IdType = FDCAN_STANDARD_ID,
+            .FilterIndex = 0,
+            .FilterType = FDCAN_FILTER_RANGE,
+            .FilterConfig = FDCAN_FILTER_TO_RXFIFO0,
+            .FilterID1 = COMMAND_CAN_ID,
+            .FilterID2 = COMMAND_CAN_ID + utils::get_idx(Cmd::count) - 1
+        };
+        if(HAL_FDCAN_ConfigFilter(&hfdcan1, &commands) != HAL_OK)
+            return;
+        if(HAL_FDCAN_ConfigGlobalFilter(&hfdcan1, FDCAN_REJECT, FDCAN_REJECT,
+                                        FDCAN_REJECT_REMOTE, FDCAN_REJECT_REMOTE) != HAL_OK)
+            return;
+        started_ = HAL_FDCAN_Start(&hfdcan1) == HAL_OK;
+    }
+
+    [[nodiscard]] bool IsStarted() const{
+        return started_;
+    }
+
+    bool Queue(Msg msg, const Payload& data){
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        auto next = (head_ + 1) % kQueueSize;
+        bool queued = next != tail_;
+        if(queued){
+            queue_[head_] = {msg, data};
+            head_ = next;
+        }else
+            dropped_++;
+        __set_PRIMASK(primask);
+        return queued;
+    }
+
+    // byte 0 index, bytes 4..7 value little endian
+    bool Queue(Msg msg, uint8_t index, uint32_t value){
+        return Queue(msg, Payload{index, 0, 0, 0,
+                                  static_cast<uint8_t>(value),
+                                  static_cast<uint8_t>(value >> 8),
+                                  static_cast<uint8_t>(value >> 16),
+                                  static_cast<uint8_t>(value >> 24)});
+    }
+
+    void QueueBootProfile(){
+        for(uint8_t stage = 0; stage < BOOT_STAGE_COUNT; stage++)
+            Queue(Msg::boot_stage, stage, boot_stamps[stage]);
+    }
+
+    void Flush(){
+        while(started_ && tail_ != head_ && HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1)){
+            auto& frame = queue_[tail_];
+            FDCAN_TxHeaderTypeDef header{
+                .Identifier = TELEMETRY_CAN_ID + static_cast<uint32_t>(frame.msg),
+                .IdType = FDCAN_STANDARD_ID,
+                .TxFrameType = FDCAN_DATA_FRAME,
+                .DataLength = FDCAN_DLC_BYTES_8,
+                .ErrorStateIndicator = FDCAN_ESI_ACTIVE,
+                .BitRateSwitch = FDCAN_BRS_OFF,
+                .FDFormat = FDCAN_CLASSIC_CAN,
+                .TxEventFifoControl = FDCAN_NO_TX_EVENTS,
+                .MessageMarker = 0
+            };
+            if(HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &header, frame.data.data()) != HAL_OK)
+                return;
+            tail_ = (tail_ + 1) % kQueueSize;
+        }
+    }
+
+    // main loop, the next received command, shorter frames are zero padded
+    std::optional<Command> Receive(){
+        if(!started_ || !HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0))
+            return std::nullopt;
+        FDCAN_RxHeaderTypeDef header;
+        Command command{};
+        if(HAL_FDCAN_GetRxMessage(&hfdcan1, FDCAN_RX_FIFO0, &header, command.data.data()) != HAL_OK)
+            return std::nullopt;
+        command.cmd = static_cast<Cmd>(header.Identifier - COMMAND_CAN_ID);
+        return command;
+    }
+
+    [[nodiscard]] std::size_t Free() const{
+        return (tail_ + kQueueSize - head_ - 1) % kQueueSize;
+    }
+
+    [[nodiscard]] uint32_t Dropped() const{
+        return dropped_;
+    }
+
+private:
+    static constexpr std::size_t kQueueSize = 32;
+
+    struct Frame{
+        Msg msg;
+        Payload data;
+    };
+
+    std::array<Frame, kQueueSize> queue_ {};
+    volatile std::size_t head_ {0};
+    volatile std::size_t tail_ {0};
+    uint32_t dropped_ {0};
+    bool started_ {false};
+};
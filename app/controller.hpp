@@ -9,15 +9,22 @@
 #include "embedded_hw_utils/IO/pin.hpp"
 #include "embedded_hw_utils/IO/button.hpp"
 #include "app_config.hpp"
-#include "input_signal.hpp"
+#include "boot_profile.h"
+#include "can_telemetry.hpp"
+#include "deadline_monitor.hpp"
+#include "in_motion_output.hpp"
+#include "input_log.hpp"
+#include "motion_profiles.hpp"
+#include "port_io.hpp"
+#include "refresh_bench.hpp"
+#include "position_store.hpp"
+#include "static_instance.hpp"
 
 using namespace RBTypes;
 using namespace StepperMotor;
 using namespace pin_board;
 
 class MainController {
-    using InputPin = PIN<Readable>;
-    using OutputPin = PIN<Writeable>;
     using Dir = StepperMotor::Direction;
     using MotorStatus = StepperMotor::Mode;
 public:
@@ -27,27 +34,117 @@ public:
     MainController(MainController&) = delete;
     MainController(MainController&&)= delete;
 
+    static void Create(){
+        instance_.Construct(MotorController::global());
+    }
+
     static MainController& global(){
-        static auto self = MainController(MotorController::global());
-        return self;
+        return *instance_;
     }
 
-    void UpdateConfig(){
-        auto config = getDIPConfig();
+    void UpdateConfig(DIPConfig config){
         oscillation_enabled_ = config.oscillation_enabled;
-        motor_controller_.UpdateConfig(config);
+        if(!profile_selected_)
+            profile_buffer_.Request(config.profile_idx);
+    }
+
+    // DIP changes are applied once, between exposures and with the motor stopped
+    void ConfigCheck(){
+        if(inputs_.Changed(PortInputs::kDipMask))
+            config_changed_ = true;
+        if(!config_changed_ || motor_controller_.IsMotorMoving())
+            return;
+        if(isInState(State::scanning) || isInState(State::oscillation))
+            return;
+        config_changed_ = false;
+        UpdateConfig(getDIPConfig(inputs_.State()));
+    }
+
+    // runtime profile selection, overrides the DIP switches until reboot
+    bool SelectProfile(uint8_t idx){
+        if(!profile_store_.Get(idx))
+            return false;
+        profile_selected_ = true;
+        profile_buffer_.Request(idx);
+        return true;
+    }
+
+    void ApplyPendingProfile(){
+        if(motor_controller_.IsMotorMoving())
+            return;
+        if(auto slot = profile_buffer_.Swap()){
+            motor_controller_.UpdateConfig(slot->cfg);
+            telemetry_.Queue(CanTelemetry::Msg::profile, slot->idx, 0);
+        }
+    }
+
+    void CommandCheck(){
+        while(auto command = telemetry_.Receive()){
+            switch(command->cmd){
+                case CanTelemetry::Cmd::select_profile:
+                    SelectProfile(command->data[0]);
+                    break;
+                default:
+                    break;
+            }
+        }
     }
 
     void InvertPins(){
-        input_pins_[utils::get_idx(Input::exp_req)].setInverted();
-        input_pins_[utils::get_idx(Input::grid_home)].setInverted();
-        input_pins_[utils::get_idx(Input::grid_in_field)].setInverted();
+        inputs_.SetInverted(InputMask(Input::exp_req)
+                          | InputMask(Input::grid_home)
+                          | InputMask(Input::grid_in_field));
     }
 
     void BoardInit(){
-        UpdateConfig();
+        in_motion_.Init();
+        position_store_.Init();
+        motor_controller_.SetTravelRange(position_store_.TravelRange());
         InvertPins();
-        test_btn.getState() ? TestMove() : InitialMove();
+        inputs_.Init();
+        UpdateConfig(getDIPConfig(inputs_.State()));
+        if(!FAST_BOOT){
+            DeferredInit();
+            ApplyPendingProfile();
+        }
+        if(inputs_.IsHigh(NOTUSED_PUSHBUTTON_Pin))
+            TestMove();
+        else if(!RestorePosition())
+            InitialMove();
+    }
+
+    // not needed for the first move: with FAST_BOOT runs from the main loop once it is started,
+    // the profile requested by the DIP switches is swapped in by the control tick when idle
+    void DeferredInit(){
+        profile_store_.Load();
+        profile_buffer_.Prepare(profile_store_);
+        telemetry_.Init();
+        deferred_init_done_ = true;
+        BootProfile_Stamp(BOOT_STAGE_DEFERRED_INIT);
+    }
+
+    void BackgroundTasks(){
+        if(!deferred_init_done_)
+            DeferredInit();
+        CommandCheck();
+        profile_buffer_.Prepare(profile_store_);
+        position_store_.Flush(!motor_controller_.IsMotorMoving());
+        ReportBootProfile();
+        if constexpr(REFRESH_BENCH)
+            RefreshBench::Report(telemetry_);
+        input_log_.Report(telemetry_);
+        Deadlines::Report(telemetry_);
+        telemetry_.Flush();
+    }
+
+    // once the first step is made, or the boot ended without a move
+    void ReportBootProfile(){
+        if(boot_reported_)
+            return;
+        if(!boot_stamps[BOOT_STAGE_FIRST_STEP] && motor_controller_.IsMotorMoving())
+            return;
+        telemetry_.QueueBootProfile();
+        boot_reported_ = true;
     }
 
     void TestMove(){
@@ -68,15 +165,55 @@ public:
         }
     }
 
+    // the record holds the rest state only, not an absolute position: the motor stays
+    // unreferenced and moves plan as without a travel range until the next arrival home
+    bool RestorePosition(){
+        auto record = position_store_.Restore();
+        auto at_home = isSignalHigh(Input::grid_home);
+        auto in_field = isSignalHigh(Input::grid_in_field);
+        if(!record || at_home == in_field)
+            return false;
+        if(record->state == State::grid_home && !at_home)
+            return false;
+        if(record->state == State::grid_in_field && !in_field)
+            return false;
+        if(record->source == PositionStore::Source::backup_registers){
+            ChangeDeviceState(record->state);
+            motor_controller_.StandByModeOn();
+        }else
+            VerificationMove(record->state);
+        return true;
+    }
+
+    void VerificationMove(State state){
+        ChangeDeviceState(State::service_moving);
+        if(state == State::grid_home){
+            motor_controller_.MoveToPos(Dir::FORWARD, RUN_OUT_STEPS);
+            pending_move_ = [&]{ RasterMoveHome(MoveSpeed::slow); };
+        }else{
+            motor_controller_.MoveToPos(Dir::BACKWARDS, RUN_OUT_STEPS);
+            pending_move_ = [&]{ RasterMoveInField(MoveSpeed::slow); };
+        }
+    }
+
     bool isInState(State status){
        return current_state_ == status;
    }
 
+    static uint32_t InputMask(Input pin){
+        return kInputMasks[utils::get_idx(pin)];
+    }
+
     bool isSignalHigh(Input pin){
-        return static_cast<bool>(input_pins_[utils::get_idx(pin)].getState());
+        return inputs_.IsHigh(InputMask(pin));
     }
 
     void ChangeDeviceState(State new_state){
+        if(new_state != current_state_){
+            position_store_.Save(new_state);
+            telemetry_.Queue(CanTelemetry::Msg::state, utils::get_idx(new_state),
+                             static_cast<uint32_t>(motor_controller_.Position()));
+        }
         current_state_ = new_state;
     }
 
@@ -89,12 +226,29 @@ public:
         motor_controller_.SlowDownAndStop();
     }
 
-    void CorrectExpoSteps(){
-        motor_controller_.EndSideStepsCorr();
+    void CorrectExpoSteps(Dir switch_side){
+        motor_controller_.ExpoSwitchReached(switch_side);
     }
 
     void SetOutputSignal(Output sigType, logic_level level){
-        output_pins_[utils::get_idx(sigType)].setValue(level);
+        outputs_.Set(kOutputMasks[utils::get_idx(sigType)], level == HIGH);
+    }
+
+    // fires once per press, after the button is held for BUTTON_HOLD_TICKS
+    void ButtonCheck(){
+        if(!IsMotionAllowed() || !inputs_.IsHigh(GRID_BUTTON_Pin)){
+            button_ticks_ = 0;
+            return;
+        }
+        if(button_ticks_ < BUTTON_HOLD_TICKS && ++button_ticks_ == BUTTON_HOLD_TICKS)
+            BtnEventHandle();
+    }
+
+    // NOTUSED_PUSHBUTTON after boot dumps the input log, so does an exp_req error
+    void InputLogCheck(){
+        input_log_.Record(inputs_.Raw());
+        if(inputs_.Rise() & NOTUSED_PUSHBUTTON_Pin)
+            input_log_.Dump();
     }
 
     void BtnEventHandle(){
@@ -107,28 +261,88 @@ public:
     void ErrorsCheck(){
         if(motor_controller_.CurrentMoveMode() == MotorStatus::in_ERROR)
             currentError_ = Error::limit_switch_error;
+        if(currentError_ == Error::no_error && Deadlines::StopRequested()){
+            ChangeDeviceState(State::error);
+            currentError_ = Error::deadline_error;
+        }
         if(currentError_ != Error::no_error)
             ErrorHandler_(currentError_);
     }
 
     void LimitSwitchesCheck(){
-        if(switch_ignore_flag_)
-            return;
         HomeSwitchCheck();
         InFieldSwitchCheck();
+        CalibrationCheck();
+    }
+
+    void StartCalibration(){
+        calibration_tried_ = true;
+        ChangeDeviceState(State::calibration);
+        motor_controller_.MoveToEndPointSlow(Dir::FORWARD);
+    }
+
+    // the run to the in field switch crosses the field, so it is queued only from grid_home
+    // without an exposure request and dropped if exp_req rises before it starts. An exposure
+    // taken meanwhile queues it again when it ends at home. A run that found no valid range is
+    // not repeated until a fast move finds the range changed
+    void QueueCalibration(){
+        if(motor_controller_.HasTravelRange() || calibration_tried_ || isSignalHigh(Input::exp_req))
+            return;
+        pending_move_ = [&]{
+            if(isInState(State::grid_home) && !isSignalHigh(Input::exp_req))
+                StartCalibration();
+        };
+    }
+
+    // learns the in field switch edge in absolute position, the travel range is its distance
+    // from the home switch edge (position 0)
+    void CalibrationCheck(){
+        if(!isInState(State::calibration))
+            return;
+        if(!isSignalHigh(Input::grid_in_field))
+            return;
+        StopMotor();
+        ChangeDeviceState(State::grid_in_field);
+        motor_controller_.StandByModeOn();
+        auto in_field_pos = motor_controller_.Position();
+        if(motor_controller_.IsReferenced() && in_field_pos > 0){
+            uint32_t range = in_field_pos;
+            motor_controller_.SetTravelRange(range);
+            if(motor_controller_.HasTravelRange())
+                position_store_.SaveTravelRange(range);
+        }
+        pending_move_ = [&]{ RasterMoveHome(MoveSpeed::fast); };
+    }
+
+    // a fast move planned from the travel range met the switch early: the mechanics changed
+    void TravelRangeCheck(){
+        if(!motor_controller_.HasTravelRange() || !motor_controller_.IsSwitchReachedEarly())
+            return;
+        motor_controller_.SetTravelRange(std::nullopt);
+        position_store_.SaveTravelRange(0);
+        calibration_tried_ = false;
+    }
+
+    // limit switch state for move control, with the step path masking applied
+    bool isSwitchActive(Input pin){
+        return isSignalHigh(pin) && !(motor_controller_.SwitchMask() & InputMask(pin));
     }
 
     void HomeSwitchCheck(){
-        if(isSignalHigh(Input::grid_home)){
-            SetOutputSignal(Output::indication_0, HIGH);
+        SetOutputSignal(Output::indication_0, isSignalHigh(Input::grid_home) ? HIGH : LOW);
+        if(IsMotionAllowed() && isSwitchActive(Input::grid_home)){
             switch (current_state_){
                 case State::moving_home:
+                    TravelRangeCheck();
+                    motor_controller_.ReferenceHome();
                     StopMotor();
                     ChangeDeviceState(State::grid_home);
                     motor_controller_.StandByModeOn();
+                    QueueCalibration();
                     break;
                 case State::oscillation:
-                    CorrectExpoSteps();
+                    CorrectExpoSteps(Dir::BACKWARDS);
+                    motor_controller_.MaskSwitches(InputMask(Input::grid_home), SWITCH_MASK_STEPS);
                     break;
                 case State::grid_in_field:
                 case State::grid_home:
@@ -137,14 +351,14 @@ public:
                 default:
                     break;
             }
-        }else
-            SetOutputSignal(Output::indication_0, LOW);
+        }
     }
 
     void InFieldSwitchCheck(){
-        if(isSignalHigh(Input::grid_in_field)){
+        if(IsMotionAllowed() && isSwitchActive(Input::grid_in_field)){
             switch (current_state_) {
                 case State::moving_in_field:
+                    TravelRangeCheck();
                     StopMotor();
                     ChangeDeviceState(State::grid_in_field);
                     motor_controller_.StandByModeOn();
@@ -156,16 +370,26 @@ public:
     }
 
     void MoveCloserToSwitch(){
-        FreezeSwitchCheck(50);
         motor_controller_.MakeStepsAfterSwitch();
+        motor_controller_.MaskSwitches(InputMask(Input::grid_home) | InputMask(Input::grid_in_field),
+                                       SWITCH_PRESS_STEPS);
     }
 
     void ExpStateCheck(){
+        if(!IsMotionAllowed())
+            return;
         if(isSignalHigh(Input::exp_req) || isInState(State::oscillation) || isInState(State::scanning))
             ExpositionProcedure();
     }
 
+    // State::error is left only by a reset, the motor stays where ErrorHandler_ stopped it
+    [[nodiscard]] bool IsMotionAllowed() const{
+        return current_state_ != State::error;
+    }
+
     void CheckPendingMove(){
+        if(!IsMotionAllowed())
+            return;
         if(pending_move_ && (!motor_controller_.IsMotorMoving())){
             auto callable = *pending_move_;
             pending_move_.reset();
@@ -174,10 +398,16 @@ public:
     }
 
     void BoardUpdate(){
+        inputs_.Update();
+        InputLogCheck();
         ErrorsCheck();
         LimitSwitchesCheck();
         ExpStateCheck();
+        ConfigCheck();
+        ApplyPendingProfile();
+        ButtonCheck();
         CheckPendingMove();
+        outputs_.Apply();
     }
 
     void RasterMoveInField(MoveSpeed speed){
@@ -202,14 +432,6 @@ public:
                                    motor_controller_.MoveToEndPointFast(Dir::BACKWARDS);
     }
 
-    void FreezeSwitchCheck(uint16_t delay = 300){
-        if(isInState(State::service_moving))
-            return;
-        current_tim_task_ = TimTask::freeze_switch;
-        switch_ignore_flag_ = true;
-        StartTaskTimIT(delay);
-    }
-
     void RasterMoveInFieldAfterExpo(){
         SlowStopMotor();
         pending_move_ = [&]{
@@ -229,15 +451,25 @@ public:
     void ExpRequestedOnHoneGrid(){
         ChangeDeviceState(State::error);
         currentError_ = Error::exp_req_error;
+        input_log_.Dump();
     }
 
     void SetInMotionSigWithDelay(){
-        current_tim_task_ = TimTask::in_motion_delay;
-        StartTaskTimIT(IN_MOTION_mSec_DELAY);
+        in_motion_.ScheduleAt(MotionClock::Now() + IN_MOTION_uSec_DELAY);
     }
 
     void SetInMotionSig(logic_level level){
-        SetOutputSignal(Output::in_motion, level);
+        level == HIGH ? in_motion_.Set() : in_motion_.Reset();
+    }
+
+    void ScheduleInMotionSig(){
+        if(auto timestamp = motor_controller_.PredictedCruiseTimestamp(IN_MOTION_LEAD_uSec))
+            in_motion_.ScheduleAt(*timestamp);
+    }
+
+    void CruiseSpeedReached(){
+        if(isInState(State::oscillation))
+            SetInMotionSig(HIGH);
     }
 
     void StartOscillation(){
@@ -247,17 +479,10 @@ public:
             lastPosition_ = State::grid_in_field;
             ChangeDeviceState(State::oscillation);
             motor_controller_.Exposition();
+            ScheduleInMotionSig();
         };
     }
 
-    bool IsInMotionSigReady(){
-//        auto dir = motor_controller_.CurrentDirection() == StepperMotor::Direction::BACKWARDS;
-        auto event = motor_controller_.GetEvent() == StepperMotor::EVENT_CSS;
-        auto in_time = motor_controller_.TimeOfAccelPhase() >= IN_MOTION_uSec_DELAY;
-//        return in_mode && in_time && dir;
-        return event && in_time;
-    }
-
     void ExpositionProcedure(){
         if(isSignalHigh(Input::exp_req)){
             switch (current_state_) {
@@ -280,10 +505,6 @@ public:
                     }
                     break;
 
-                case State::oscillation:
-                    if(IsInMotionSigReady())
-                        SetInMotionSig(HIGH);
-                    break;
                 default:
                     break;
             }
@@ -298,8 +519,10 @@ public:
             case State::grid_home:
                 if(oscillation_enabled_)
                     RasterMoveHome(MoveSpeed::slow);
-                else
+                else{
                     ChangeDeviceState(State::grid_home);
+                    QueueCalibration();
+                }
                 break;
             case State::grid_in_field:
                 if(oscillation_enabled_)
@@ -312,68 +535,70 @@ public:
         }
     }
 
-    void TimTaskHandler(){
-        switch (current_tim_task_) {
-            case TimTask::freeze_switch:
-                UnFreezeSwitches();
-                break;
-            case TimTask::in_motion_delay:
-                SetInMotionSig(HIGH);
-                break;
-            default:
-                break;
-        }
-        current_tim_task_ = TimTask::no_task;
-    }
-
-    void UnFreezeSwitches(){
-        switch_ignore_flag_ = false;
-    }
-
 private:
+    friend class StaticInstance<MainController>;
+    static StaticInstance<MainController> instance_;
+
     explicit MainController(MotorController &incomeMotorController)
         :motor_controller_(incomeMotorController)
-    {}
+    {
+        motor_controller_.OnCruiseSpeed([this]{ CruiseSpeedReached(); });
+    }
 
+    // GPIOA bit masks, indexed by Input / Output
     static constexpr int kIN_PIN_CNT = 3;
-    std::array<InputPin, kIN_PIN_CNT> input_pins_{
-            InputPin(EXP_REQ_IN_GPIO_Port, EXP_REQ_IN_Pin),
-            InputPin(GRID_INFIELD_DETECT_GPIO_Port, GRID_INFIELD_DETECT_Pin),
-            InputPin(GRID_HOME_DETECT_GPIO_Port, GRID_HOME_DETECT_Pin),
+    static constexpr std::array<uint32_t, kIN_PIN_CNT> kInputMasks{
+            EXP_REQ_IN_Pin,
+            GRID_INFIELD_DETECT_Pin,
+            GRID_HOME_DETECT_Pin,
     };
-    static constexpr int kOUT_PIN_CNT = 3;
-    std::array<OutputPin, kOUT_PIN_CNT> output_pins_{
-            OutputPin(INDICATION_0_OUT_GPIO_Port, INDICATION_0_OUT_Pin),
-            OutputPin(INDICATION_1_OUT_GPIO_Port, INDICATION_1_OUT_Pin),
-            OutputPin(IN_MOTION_OUT_GPIO_Port, IN_MOTION_OUT_Pin)
+    static constexpr int kOUT_PIN_CNT = 2;
+    static constexpr std::array<uint32_t, kOUT_PIN_CNT> kOutputMasks{
+            INDICATION_0_OUT_Pin,
+            INDICATION_1_OUT_Pin,
     };
-    InputPin test_btn {NOTUSED_PUSHBUTTON_GPIO_Port, NOTUSED_PUSHBUTTON_Pin};
-//    InputSignal t_btn {InputPin{NOTUSED_PUSHBUTTON_GPIO_Port, NOTUSED_PUSHBUTTON_Pin}, 2};
+    PortInputs inputs_;
+    PortOutputs outputs_;
+    InMotionOutput in_motion_;
+    PositionStore position_store_;
+    ProfileStore profile_store_;
+    ProfileBuffer profile_buffer_;
+    CanTelemetry telemetry_;
+    InputLog input_log_;
 
     MotorController& motor_controller_;
-    TimTask current_tim_task_ {TimTask::no_task};
     Error currentError_ {Error::no_error};
     State current_state_ {State::init_state};
     State lastPosition_ {State::grid_in_field};
 
     bool oscillation_enabled_ {false};
-    bool switch_ignore_flag_ {false};
+    bool profile_selected_ {false};
+    bool config_changed_ {false};
+    bool deferred_init_done_ {false};
+    bool boot_reported_ {false};
+    bool calibration_tried_ {false};
+    uint16_t button_ticks_ {0};
     const bool kRasterHomeExpReqIsOk_ {true};
 
     std::optional<std::function<void()>> pending_move_;
 
     void ErrorHandler_(Error error){
         StopMotor();
+        pending_move_.reset();
+        // also disarms a TIM2 CH1 compare still pending from the stopped move
+        SetInMotionSig(LOW);
         SetOutputSignal(Output::indication_1, HIGH);
         switch (error) {
             case Error::initial_movement_error:
             case Error::limit_switch_error:
                 break;
             case Error::exp_req_error:
+            case Error::deadline_error:
                 return;
             default:
                 break;
         }
         Error_Handler();
     }
-};
\ No newline at end of file
+};
+inline constinit StaticInstance<MainController> MainController::instance_;
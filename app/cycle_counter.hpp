@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include "main.h"
+
+// DWT cycle counter, 1 cycle = 1/170 MHz
+struct CycleCounter{
+    // counting from reset is started by Board_CycleCounterStart() in main()
+    static void Init(){
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    static uint32_t Now(){
+        return DWT->CYCCNT;
+    }
+};
+
+struct CycleStats{
+    uint32_t last {0};
+    uint32_t max {0};
+    uint32_t min {UINT32_MAX};
+    uint64_t total {0};
+    uint32_t count {0};
+
+    void Add(uint32_t cycles){
+        last = cycles;
+        if(cycles > max)
+            max = cycles;
+        if(cycles < min)
+            min = cycles;
+        total += cycles;
+        count++;
+    }
+
+    [[nodiscard]] uint32_t Average() const{
+        return count ? static_cast<uint32_t>(total / count) : 0;
+    }
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "main.h"
+#include "app_config.hpp"
+#include "can_telemetry.hpp"
+#include "motion_clock.hpp"
+
+// Execution time of a periodic interrupt task against its period, recorded at the end of
+// every invocation together with its entry time on MotionClock. A handler longer than its
+// budget is an overrun. Timer events that come while the handler is still pending set the
+// same flag: the first is served late, the others are merged into it and lost. Those are
+// the missed ticks, counted from the time since the previous invocation, so a stall of any
+// length is seen (the IWDG refreshed from the tick would not notice it).
+class DeadlineMonitor{
+public:
+    enum class Task : uint8_t{
+        control_tick,   // TIM1, BoardUpdate
+        step_isr,       // TIM4 CC2, MotorRefresh
+        count
+    };
+
+    constexpr DeadlineMonitor(uint32_t budget_pct)
+        :budget_pct_(budget_pct)
+    {}
+
+    // interrupt context. period_us is the time to the next invocation, start_us the
+    // MotionClock time at entry
+    void Record(uint32_t cycles, uint32_t period_us, uint32_t start_us){
+        auto exec_us = cycles / (SystemCoreClock / 1000000);
+        max_us_ = std::max(max_us_, exec_us);
+        if(period_us)
+            max_load_pct_ = std::max(max_load_pct_, exec_us * 100 / period_us);
+        if(exec_us * 100 > period_us * budget_pct_){
+            overruns_++;
+            overruns_in_row_++;
+        }else
+            overruns_in_row_ = 0;
+        uint32_t missed_in_row = 0;
+        if(anchored_ && last_period_us_){
+            auto due = (start_us - last_start_us_) / last_period_us_;
+            if(due > 1)
+                missed_in_row = due - 1;
+            missed_ += missed_in_row;
+        }
+        last_start_us_ = start_us;
+        last_period_us_ = period_us;
+        anchored_ = !masked_;
+        if constexpr (kStopMissed > 0){
+            if(missed_in_row >= kStopMissed)
+                stop_requested_ = true;
+        }
+        if constexpr (kStopOverruns > 0){
+            if(overruns_in_row_ >= kStopOverruns)
+                stop_requested_ = true;
+        }
+    }
+
+    // the next invocation is not expected one period after the last one, e.g. the first
+    // step of a move
+    void Restart(){
+        anchored_ = false;
+    }
+
+    // ticks delayed while masked are not counted, for planned stalls such as a flash erase
+    void Mask(bool masked){
+        masked_ = masked;
+        anchored_ = false;
+    }
+
+    [[nodiscard]] uint32_t Overruns() const{ return overruns_; }
+    [[nodiscard]] uint32_t Missed() const{ return missed_; }
+    [[nodiscard]] uint32_t MaxUSec() const{ return max_us_; }
+    [[nodiscard]] bool StopRequested() const{ return stop_requested_; }
+
+    // CanTelemetry::Msg::deadline: task, max load %, max execution uSec, overruns and missed
+    // ticks as u16, saturated
+    [[nodiscard]] CanTelemetry::Payload Frame(Task task) const{
+        auto max_us = Saturate(max_us_);
+        auto overruns = Saturate(overruns_);
+        auto missed = Saturate(missed_);
+        return {static_cast<uint8_t>(task), static_cast<uint8_t>(std::min<uint32_t>(max_load_pct_, 0xFF)),
+                static_cast<uint8_t>(max_us), static_cast<uint8_t>(max_us >> 8),
+                static_cast<uint8_t>(overruns), static_cast<uint8_t>(overruns >> 8),
+                static_cast<uint8_t>(missed), static_cast<uint8_t>(missed >> 8)};
+    }
+
+private:
+    static constexpr uint32_t kStopMissed = DEADLINE_STOP_MISSED;
+    static constexpr uint32_t kStopOverruns = DEADLINE_STOP_OVERRUNS;
+
+    static uint16_t Saturate(uint32_t value){
+        return static_cast<uint16_t>(std::min<uint32_t>(value, 0xFFFF));
+    }
+
+    uint32_t budget_pct_;
+    uint32_t last_start_us_ {0};
+    uint32_t last_period_us_ {0};
+    volatile bool anchored_ {false};
+    volatile bool masked_ {false};
+    uint32_t max_us_ {0};
+    uint32_t max_load_pct_ {0};
+    volatile uint32_t overruns_ {0};
+    uint32_t overruns_in_row_ {0};
+    volatile uint32_t missed_ {0};
+    volatile bool stop_requested_ {false};
+};
+
+// The monitored tasks. A safe stop requested by any of them is taken by the control tick,
+// the counters go out every DEADLINE_REPORT_MS from the main loop.
+struct Deadlines{
+    static inline DeadlineMonitor control_tick {CONTROL_TICK_BUDGET_PCT};
+    static inline DeadlineMonitor step_isr {STEP_ISR_BUDGET_PCT};
+
+    static bool StopRequested(){
+        return control_tick.StopRequested() || step_isr.StopRequested();
+    }
+
+    // main loop, around work that stalls flash fetch for more than a tick with the motor idle
+    static void Mask(){
+        control_tick.Mask(true);
+        step_isr.Mask(true);
+    }
+
+    static void Unmask(){
+        control_tick.Mask(false);
+        step_isr.Mask(false);
+    }
+
+    static void Report(CanTelemetry& telemetry){
+        if(!DEADLINE_REPORT_MS || !MotionClock::IsReached(next_report_))
+            return;
+        // state changes queued from the control tick keep their room
+        if(telemetry.Free() <= kFreeReserve + utils::get_idx(DeadlineMonitor::Task::count))
+            return;
+        telemetry.Queue(CanTelemetry::Msg::deadline, control_tick.Frame(DeadlineMonitor::Task::control_tick));
+        telemetry.Queue(CanTelemetry::Msg::deadline, step_isr.Frame(DeadlineMonitor::Task::step_isr));
+        next_report_ = MotionClock::Now() + DEADLINE_REPORT_MS * 1000;
+    }
+
+private:
+    static constexpr std::size_t kFreeReserve = 4;
+
+    static inline uint32_t next_report_ {0};
+};
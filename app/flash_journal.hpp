@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "main.h"
+
+extern "C" uint32_t _sjournal[];
+extern "C" uint32_t _ejournal[];
+
+// Append-only key/value log in the last flash page (see JOURNAL in the linker script).
+// Every write programs one double word, the page is erased only when it is full and then
+// compacted to the latest value of each key. Programming stalls flash fetch, so Append()
+// is called from the main loop and only while the motor is idle.
+class FlashJournal{
+public:
+    static constexpr uint8_t kMaxKeys = 8;
+
+    [[nodiscard]] std::optional<uint32_t> Read(uint8_t key) const{
+        std::optional<uint32_t> value;
+        for(auto entry = Begin(); entry != End() && !IsErased(*entry); entry++){
+            if(entry->key == key && entry->check == Check(*entry))
+                value = entry->value;
+        }
+        return value;
+    }
+
+    bool Append(uint8_t key, uint32_t value){
+        if(key == kErasedKey || key >= kMaxKeys)
+            return false;
+        if(Read(key) == value)
+            return true;
+        auto free_entry = FirstFree();
+        if(free_entry == End()){
+            if(!Compact())
+                return false;
+            free_entry = FirstFree();
+        }
+        return Program(free_entry, key, value);
+    }
+
+    // the next Append() of a new value erases the page
+    [[nodiscard]] bool IsFull() const{
+        return FirstFree() == End();
+    }
+
+private:
+    struct Entry{
+        uint8_t key;
+        uint8_t check;
+        uint16_t reserved;
+        uint32_t value;
+    };
+    static_assert(sizeof(Entry) == sizeof(uint64_t));
+
+    static constexpr uint8_t kErasedKey = 0xFF;
+
+    static const Entry* Begin(){
+        return reinterpret_cast<const Entry*>(_sjournal);
+    }
+
+    static const Entry* End(){
+        return reinterpret_cast<const Entry*>(_ejournal);
+    }
+
+    static bool IsErased(const Entry& entry){
+        return entry.key == kErasedKey;
+    }
+
+    static uint8_t Check(const Entry& entry){
+        uint8_t check = 0xA5 ^ entry.key;
+        for(int i = 0; i < 4; i++)
+            check ^= static_cast<uint8_t>(entry.value >> (i * 8));
+        return check;
+    }
+
+    static const Entry* FirstFree(){
+        auto entry = Begin();
+        while(entry != End() && !IsErased(*entry))
+            entry++;
+        return entry;
+    }
+
+    bool Compact(){
+        std::array<std::optional<uint32_t>, kMaxKeys> latest;
+        for(uint8_t key = 0; key < kMaxKeys; key++)
+            latest[key] = Read(key);
+        if(!ErasePage())
+            return false;
+        auto entry = Begin();
+        for(uint8_t key = 0; key < kMaxKeys; key++){
+            if(latest[key] && !Program(entry++, key, *latest[key]))
+                return false;
+        }
+        return true;
+    }
+
+    static bool ErasePage(){
+        FLASH_EraseInitTypeDef erase{
+            .TypeErase = FLASH_TYPEERASE_PAGES,
+            .Banks = FLASH_BANK_1,
+            .Page = (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(_sjournal)) - FLASH_BASE) / FLASH_PAGE_SIZE,
+            .NbPages = 1
+        };
+        uint32_t page_error = 0;
+        HAL_FLASH_Unlock();
+        auto status = HAL_FLASHEx_Erase(&erase, &page_error);
+        HAL_FLASH_Lock();
+        return status == HAL_OK;
+    }
+
+    static bool Program(const Entry* address, uint8_t key, uint32_t value){
+        Entry entry{key, 0, 0, value};
+        entry.check = Check(entry);
+        uint64_t data = 0;
+        __builtin_memcpy(&data, &entry, sizeof(entry));
+        HAL_FLASH_Unlock();
+        auto status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(address)),
+                                        data);
+        HAL_FLASH_Lock();
+        return status == HAL_OK;
+    }
+};
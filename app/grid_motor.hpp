@@ -1,9 +1,14 @@
 #pragma once
 
 #include "app_config.hpp"
+#include "deadline_monitor.hpp"
+#include "motion_clock.hpp"
+#include "motion_planner.hpp"
+#include "static_instance.hpp"
 #include "embedded_hw_utils/motors/stepper_motor/accel_motor.hpp"
 
 #include <cmath>
+#include <functional>
 
 using namespace MotorSpecial;
 
@@ -25,47 +30,108 @@ public:
 
     void UpdateConfig(AppCfg cfg){
         SetDirInversion(cfg.direction_inverted);
+        if(IsProfileChanged(cfg.accelCfg)){
+            planner_.Invalidate();
+            service_ramp_.Invalidate();
+        }
+        profile_ = cfg.accelCfg;
         AccelMotor::UpdateConfig(cfg.accelCfg);
     }
 
+    void OnCruiseSpeed(std::function<void()> callback){
+        on_cruise_speed_ = std::move(callback);
+    }
+
+    [[nodiscard]] std::optional<uint32_t> PredictedCruiseTimestamp(uint32_t lead) const{
+        return planner_.CruiseTimestamp(expo_start_ts_, lead);
+    }
+
+    static void Create(){
+        instance_.Construct(getBaseConfig());
+    }
+
     static MotorController& global(){
-        static MotorController motorController(getDIPConfig());
-        return motorController;
+        return *instance_;
     }
     
+    // SERVICE_MOVE_MAX_SPEED needs the ramp AccelMotor runs for the active profile up to it
+    // and the same ramp down: its length is measured on the first fast move that reaches
+    // that speed, moves shorter than twice that run at INIT_MOVE_MAX_SPEED. until_measured
+    // is used before that
+    [[nodiscard]] bool IsServiceSpeedReachable(uint32_t steps, bool until_measured) const{
+        auto ramp_steps = service_ramp_.CruiseSteps();
+        return ramp_steps ? steps >= 2 * *ramp_steps : until_measured;
+    }
+
     void MoveToPos(StepperMotor::Direction dir, uint32_t steps){
         current_state_ = MoveMode::kService_slow;
-        MakeMotorTask(INITIAL_SPEED, INIT_MOVE_MAX_SPEED,
-                      dir, steps);
+        StartServiceTask(IsServiceSpeedReachable(steps, false), dir, steps);
     }
 
     void MoveToEndPointSlow(StepperMotor::Direction dir){
         current_state_ = MoveMode::kService_slow;
-        MakeMotorTask(INITIAL_SPEED, INIT_MOVE_MAX_SPEED,
-                      dir, GetTotalRangeSteps());
+        StartTask(INITIAL_SPEED, INIT_MOVE_MAX_SPEED,
+                  dir, GetTotalRangeSteps());
     }
 
     void MoveToEndPointFast(StepperMotor::Direction dir){
+        auto steps = StepsBeforeDecel(dir);
+        if(!steps){
+            MoveToEndPointSlow(dir);
+            return;
+        }
         current_state_ = MoveMode::kService_accel;
-        MakeMotorTask(INITIAL_SPEED, SERVICE_MOVE_MAX_SPEED,
-                      dir, STEPS_BEFORE_DECCEL);
+        StartServiceTask(IsServiceSpeedReachable(steps, true), dir, steps);
+    }
+
+    static bool IsTravelRangeValid(uint32_t steps){
+        return steps >= TRAVEL_RANGE_MIN_STEPS && steps <= TOTAL_RANGE_STEPS;
+    }
+
+    void SetTravelRange(std::optional<uint32_t> steps){
+        if(steps && IsTravelRangeValid(*steps))
+            travel_range_ = steps;
+        else
+            travel_range_.reset();
+    }
+
+    [[nodiscard]] bool HasTravelRange() const{
+        return travel_range_.has_value();
+    }
+
+    // steps from the current position to SWITCH_APPROACH_STEPS before the switch edge ahead,
+    // both edges in absolute position: home at 0, in field at the travel range. 0 when the
+    // grid is already that close
+    [[nodiscard]] uint32_t StepsBeforeDecel(StepperMotor::Direction dir) const{
+        if(!travel_range_ || !referenced_)
+            return STEPS_BEFORE_DECCEL;
+        constexpr auto approach = static_cast<int32_t>(SWITCH_APPROACH_STEPS);
+        int32_t distance = dir == StepperMotor::Direction::FORWARD
+                         ? static_cast<int32_t>(*travel_range_) - approach - position_
+                         : position_ - approach;
+        return distance > 0 ? distance : 0;
+    }
+
+    // switch reached while the fast move still had steps to run before its planned end
+    bool IsSwitchReachedEarly(){
+        return current_state_ == MoveMode::kService_accel
+            && CurrentStep() + SWITCH_APPROACH_STEPS < StepsToGo();
     }
 
     void MakeStepsAfterSwitch(){
         current_state_ = MoveMode::kSwitch_press;
-        MakeMotorTask(INITIAL_SPEED, INITIAL_SPEED,
-                      CurrentDirection(), SWITCH_PRESS_STEPS);
+        StartTask(INITIAL_SPEED, INITIAL_SPEED,
+                  CurrentDirection(), SWITCH_PRESS_STEPS);
     }
 
+    // oscillation between two absolute targets, expo_distance_steps_ apart, starting toward dir
     void Exposition(StepperMotor::Direction dir = StepperMotor::Direction::BACKWARDS){
         current_state_ = MoveMode::kExpo;
-        MakeMotorTask(INITIAL_SPEED, config_Vmax_, dir, expo_distance_steps_);
-    }
-
-    void ChangeDirAbnormalExpo(){
-        if(CurrentDirection() == StepperMotor::Direction::BACKWARDS)
-            ChangeDirection();
-        StepsCorrectionHack();
+        int32_t start = position_;
+        SetExpoWindow(dir == StepperMotor::Direction::BACKWARDS ? start - expo_distance_steps_ : start);
+        expo_start_ts_ = MotionClock::Now();
+        planner_.RampStarted(expo_start_ts_);
+        StartTask(INITIAL_SPEED, config_Vmax_, dir, expo_distance_steps_);
     }
 
     void SlowDownAndStop(){
@@ -73,31 +139,121 @@ public:
         SetMode(StepperMotor::DECCEL);
     }
 
-    void EndSideStepsCorr(){
-        CorrectStepsToGo(-reach_steps_);
+    // a switch ended the oscillation leg early: its edge becomes that end of the window.
+    // switch_side points from the grid to the switch, a switch still active while the grid
+    // moves away from it (the leg already reversed at the window end) changes nothing
+    void ExpoSwitchReached(StepperMotor::Direction switch_side){
+        if(CurrentDirection() != switch_side)
+            return;
+        if(switch_side == StepperMotor::Direction::BACKWARDS)
+            SetExpoWindow(position_);
+        else
+            SetExpoWindow(position_ - expo_distance_steps_);
         ChangeDirection();
     }
 
-    void StepsCorrectionHack(){
-        CorrectCurrentStep(reach_steps_);
+    // absolute position in microsteps, FORWARD is positive, 0 is the home switch edge
+    [[nodiscard]] int32_t Position() const{
+        return position_;
+    }
+
+    [[nodiscard]] bool IsReferenced() const{
+        return referenced_;
+    }
+
+    // home switch edge reached while homing, the only way to become referenced
+    void ReferenceHome(){
+        position_ = 0;
+        referenced_ = true;
+    }
+
+    // switch bits ignored by the control tick until the grid is `steps` away from the
+    // position where the mask was set, checked in the step path so it holds at every speed
+    void MaskSwitches(uint32_t mask, uint32_t steps){
+        mask_origin_ = position_;
+        mask_distance_ = steps;
+        switch_mask_ = steps ? mask : 0;
+    }
+
+    [[nodiscard]] uint32_t SwitchMask() const{
+        return switch_mask_;
     }
 
 private:
+    friend class StaticInstance<MotorController>;
+    static StaticInstance<MotorController> instance_;
+
     MotorController(AppCfg cfg)
         :AccelMotor(cfg.accelCfg)
+        ,profile_(cfg.accelCfg)
     {
         UpdateConfig(cfg);
     }
 
-    int reach_steps_ {EXPO_OFFSET_STEPS};
     int expo_distance_steps_ {EXPO_RANGE_STEPS};
 
     MoveMode current_state_;
 
+    MotionPlanner planner_;
+    // accel phase of service moves up to SERVICE_MOVE_MAX_SPEED
+    MotionPlanner service_ramp_;
+    // in field switch edge, absolute position
+    std::optional<uint32_t> travel_range_;
+    MotorSpecial::AccelCfg profile_;
+    uint32_t expo_start_ts_ {0};
+    std::function<void()> on_cruise_speed_;
+    volatile int32_t position_ {0};
+    bool referenced_ {false};
+    volatile int32_t expo_min_ {0};
+    volatile int32_t expo_max_ {0};
+    volatile uint32_t switch_mask_ {0};
+    int32_t mask_origin_ {0};
+    uint32_t mask_distance_ {0};
+
+    void SetExpoWindow(int32_t min){
+        expo_min_ = min;
+        expo_max_ = min + expo_distance_steps_;
+    }
+
+    // not const: StepperMotor::CurrentDirection() is not
+    [[nodiscard]] bool IsExpoTargetReached(){
+        return CurrentDirection() == StepperMotor::Direction::BACKWARDS ? position_ <= expo_min_
+                                                                        : position_ >= expo_max_;
+    }
+
+    // a mask belongs to the move it was set for, the first step is not due one period
+    // after the last step of the previous move
+    void StartTask(float Vmin, float Vmax, StepperMotor::Direction dir, uint32_t steps){
+        MaskSwitches(0, 0);
+        Deadlines::step_isr.Restart();
+        MakeMotorTask(Vmin, Vmax, dir, steps);
+    }
+
+    // only a move run up to SERVICE_MOVE_MAX_SPEED measures its ramp
+    void StartServiceTask(bool service_speed, StepperMotor::Direction dir, uint32_t steps){
+        service_speed ? service_ramp_.RampStarted(MotionClock::Now()) : service_ramp_.RampSkipped();
+        StartTask(INITIAL_SPEED, service_speed ? SERVICE_MOVE_MAX_SPEED : INIT_MOVE_MAX_SPEED, dir, steps);
+    }
+
+    // the ramp generator reached the Vmax of the task
+    bool IsCruising(){
+        return CurrentMoveMode() == StepperMotor::CONST;
+    }
+
+    bool IsProfileChanged(const MotorSpecial::AccelCfg& cfg) const{
+        return cfg.Vmax != profile_.Vmax || cfg.Vmin != profile_.Vmin || cfg.A != profile_.A
+            || cfg.ramp_time != profile_.ramp_time || cfg.accel_type != profile_.accel_type;
+    }
+
     void AppCorrection() override{
+        position_ += CurrentDirection() == StepperMotor::Direction::FORWARD ? 1 : -1;
+        if(switch_mask_ && static_cast<uint32_t>(std::abs(position_ - mask_origin_)) >= mask_distance_)
+            switch_mask_ = 0;
         switch (current_state_){
             case MoveMode::kExpo:
-                if(CurrentStep() >= StepsToGo())
+                if(planner_.RampStep(MotionClock::Now(), CurrentStep(), IsCruising()) && on_cruise_speed_)
+                    on_cruise_speed_();
+                if(IsExpoTargetReached())
                     ChangeDirection();
                 break;
             case MoveMode::kService_slow:
@@ -106,6 +262,7 @@ private:
                     StopMotor();
                 break;
             case MoveMode::kService_accel:
+                service_ramp_.RampStep(MotionClock::Now(), CurrentStep(), IsCruising());
                 break;
             case MoveMode::kDecel_and_stop:
                 if(V_ == CurrentMinSpeed())
@@ -114,3 +271,5 @@ private:
         }
     }
 };
+
+inline constinit StaticInstance<MotorController> MotorController::instance_;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "motion_clock.hpp"
+
+// IN_MOTION_OUT is driven by TIM2_CH1 output compare, so the edge is set by hardware
+// at the scheduled timestamp and does not depend on ISR or control tick timing
+class InMotionOutput{
+public:
+    void Init(){
+        HAL_TIM_OC_Start(&htim2, TIM_CHANNEL_1);
+    }
+
+    void Set(){
+        SetOCMode(TIM_OCMODE_FORCED_ACTIVE);
+    }
+
+    void Reset(){
+        SetOCMode(TIM_OCMODE_FORCED_INACTIVE);
+    }
+
+    void ScheduleAt(uint32_t timestamp){
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, timestamp);
+        SetOCMode(TIM_OCMODE_ACTIVE);
+        if(MotionClock::IsReached(timestamp))
+            Set();
+        __set_PRIMASK(primask);
+    }
+
+private:
+    // read-modify-write of CCMR1, called from the control tick and from the step ISR
+    // (cruise speed reached)
+    static void SetOCMode(uint32_t mode){
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        auto ccmr = htim2.Instance->CCMR1;
+        ccmr &= ~TIM_CCMR1_OC1M;
+        ccmr |= mode;
+        htim2.Instance->CCMR1 = ccmr;
+        __set_PRIMASK(primask);
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "main.h"
+#include "can_telemetry.hpp"
+#include "motion_clock.hpp"
+
+// Field log of the raw EXP_REQ_IN, GRID_BUTTON and grid switch levels, one entry per control
+// tick in which any of them changed, before debouncing so generator chatter is kept.
+// The ring holds the last INPUT_LOG_SIZE edges. Dump() sends it oldest first as
+// CanTelemetry::Msg::input_log frames, sim --replay feeds such a dump back into the simulator.
+class InputLog{
+public:
+    // the logged inputs are PA6..PA9, one frame carries them as a nibble
+    static constexpr uint8_t kShift = 6;
+    static constexpr uint32_t kMask = EXP_REQ_IN_Pin | GRID_BUTTON_Pin | GRID_INFIELD_DETECT_Pin | GRID_HOME_DETECT_Pin;
+    static_assert(kMask == 0xFu << kShift);
+    static constexpr std::size_t kSize = INPUT_LOG_SIZE;
+    static_assert((kSize & (kSize - 1)) == 0);
+
+    // control tick, raw pin levels from PortInputs::Raw()
+    void Record(uint32_t raw){
+        auto levels = static_cast<uint8_t>((raw & kMask) >> kShift);
+        if(levels == levels_)
+            return;
+        ring_[head_ % kSize] = {MotionClock::Now(), levels, static_cast<uint8_t>(levels ^ levels_)};
+        levels_ = levels;
+        head_++;
+    }
+
+    // any context: everything logged until the next Report() is dumped, later edges are
+    // logged but not part of this dump
+    void Dump(){
+        dump_requested_ = true;
+    }
+
+    // main loop, one frame per entry while the telemetry queue has room:
+    // u16 sequence number, levels, changed bits, u32 MotionClock time
+    void Report(CanTelemetry& telemetry){
+        if(dump_requested_){
+            dump_requested_ = false;
+            dump_end_ = head_;
+            dump_pos_ = dump_end_ - std::min<uint32_t>(dump_end_, kSize);
+        }
+        while(dump_pos_ < dump_end_ && telemetry.Free() > kFreeReserve){
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            // entries overwritten since Dump() are gone
+            if(head_ - dump_pos_ > kSize)
+                dump_pos_ = head_ - kSize;
+            auto entry = ring_[dump_pos_ % kSize];
+            __set_PRIMASK(primask);
+            if(dump_pos_ >= dump_end_)
+                break;
+            telemetry.Queue(CanTelemetry::Msg::input_log, {
+                static_cast<uint8_t>(dump_pos_), static_cast<uint8_t>(dump_pos_ >> 8),
+                entry.levels, entry.changed,
+                static_cast<uint8_t>(entry.time), static_cast<uint8_t>(entry.time >> 8),
+                static_cast<uint8_t>(entry.time >> 16), static_cast<uint8_t>(entry.time >> 24)
+            });
+            dump_pos_++;
+        }
+    }
+
+private:
+    // state changes queued from the control tick keep their room
+    static constexpr std::size_t kFreeReserve = 4;
+
+    struct Entry{
+        uint32_t time;
+        uint8_t levels;
+        uint8_t changed;
+    };
+
+    std::array<Entry, kSize> ring_ {};
+    volatile uint32_t head_ {0};
+    uint32_t dump_pos_ {0};
+    uint32_t dump_end_ {0};
+    uint8_t levels_ {0};
+    volatile bool dump_requested_ {false};
+};
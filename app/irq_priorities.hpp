@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "main.h"
+#include "app_config.hpp"
+#include "irq_latency.h"
+
+// The one place interrupt priorities are defined, applied in AppInit over the CubeMX values.
+// NVIC_PRIORITYGROUP_4: 16 preemption levels, no subpriority, lower number preempts.
+// Limit switches, exp_req, config and the button are stages of the control tick and run in
+// that order inside BoardUpdate().
+struct IrqPriorities{
+    static constexpr uint32_t kStep = 0;            // TIM4 step generation
+    static constexpr uint32_t kControlTick = 1;     // TIM1 BoardUpdate
+    static constexpr uint32_t kSysTick = 2;         // HAL time base, flash timeouts only
+    static constexpr uint32_t kUnused = 15;         // CubeMX timers that are no longer started
+
+    struct Entry{
+        IRQn_Type irq;
+        uint32_t priority;
+    };
+
+    static constexpr std::array<Entry, 6> kMap{{
+        {TIM4_IRQn, kStep},
+        {TIM1_UP_TIM16_IRQn, kControlTick},
+        {SysTick_IRQn, kSysTick},
+        {TIM3_IRQn, kUnused},
+        {TIM6_DAC_IRQn, kUnused},
+        {TIM7_IRQn, kUnused},
+    }};
+
+    static void Apply(){
+        NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+        for(auto& entry : kMap)
+            NVIC_SetPriority(entry.irq, NVIC_EncodePriority(NVIC_PRIORITYGROUP_4, entry.priority, 0));
+        uwTickPrio = kSysTick;
+    }
+
+    // step period at CONFIG2_MAX_SPEED minus worst entry latency and worst handler time seen,
+    // negative when a step could have been late
+    static int32_t StepDeadlineMarginUSec(uint32_t handler_max_cycles){
+        auto period = static_cast<int32_t>(1e6f / CONFIG2_MAX_SPEED);
+        auto latency = static_cast<int32_t>(irq_latency[IRQ_LATENCY_STEP].max);
+        auto handler = static_cast<int32_t>(handler_max_cycles / (SystemCoreClock / 1000000));
+        return period - latency - handler;
+    }
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "main.h"
+#include "tim.h"
+
+// TIM2 free running 32-bit counter, 170MHz / 170 -> 1 tick = 1 uSec, wraps every ~71 min
+struct MotionClock{
+    static constexpr uint32_t kTicksPerUSec = 1;
+
+    static uint32_t Now(){
+        return htim2.Instance->CNT;
+    }
+
+    static bool IsReached(uint32_t timestamp){
+        return static_cast<int32_t>(Now() - timestamp) >= 0;
+    }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+// Timing and length of the accel phase taken from the step path of the ramp generator
+// itself. The ramp is deterministic for a given AccelCfg, so the time and the steps from
+// move start to the required speed measured on one move predict every later move started
+// from standstill.
+class MotionPlanner{
+public:
+    void Invalidate(){
+        cruise_time_.reset();
+        cruise_steps_.reset();
+        ramp_tracking_ = false;
+    }
+
+    void RampStarted(uint32_t timestamp){
+        ramp_start_ts_ = timestamp;
+        ramp_tracking_ = true;
+    }
+
+    // a move that is not measured, the measurement is kept
+    void RampSkipped(){
+        ramp_tracking_ = false;
+    }
+
+    // called every step with the steps made since the ramp start and whether the ramp
+    // generator is at its cruise speed, returns true only on the first cruising step
+    bool RampStep(uint32_t timestamp, uint32_t step, bool cruising){
+        if(!ramp_tracking_ || !cruising)
+            return false;
+        ramp_tracking_ = false;
+        cruise_time_ = timestamp - ramp_start_ts_;
+        cruise_steps_ = step;
+        return true;
+    }
+
+    [[nodiscard]] std::optional<uint32_t> CruiseTime() const{
+        return cruise_time_;
+    }
+
+    [[nodiscard]] std::optional<uint32_t> CruiseSteps() const{
+        return cruise_steps_;
+    }
+
+    [[nodiscard]] std::optional<uint32_t> CruiseTimestamp(uint32_t ramp_start, uint32_t lead) const{
+        if(!cruise_time_)
+            return std::nullopt;
+        auto time = *cruise_time_ > lead ? *cruise_time_ - lead : 0;
+        return ramp_start + time;
+    }
+
+private:
+    std::optional<uint32_t> cruise_time_;
+    std::optional<uint32_t> cruise_steps_;
+    uint32_t ramp_start_ts_ {0};
+    bool ramp_tracking_ {false};
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#include "app_config.hpp"
+
+extern "C" uint32_t _sprofiles[];
+
+// One named AccelCfg parameter set, as stored in flash
+struct MotionProfile{
+    char name[8];
+    uint32_t accel_type;
+    float ramp_time;
+    float A;
+    float Vmax;
+    float Vmin;
+
+    [[nodiscard]] bool IsValid() const{
+        return Vmin > 0 && Vmax > Vmin && A > 0 && Vmax <= PROFILE_MAX_SPEED && ramp_time > 0
+            && accel_type <= utils::get_idx(MotorSpecial::AccelType::kSigmoid);
+    }
+
+    [[nodiscard]] AppCfg MakeAppConfig() const{
+        auto cfg = getBaseConfig();
+        cfg.accelCfg.ramp_time = ramp_time;
+        cfg.accelCfg.accel_type = static_cast<MotorSpecial::AccelType>(accel_type);
+        cfg.accelCfg.A = A;
+        cfg.accelCfg.Vmax = Vmax;
+        cfg.accelCfg.Vmin = Vmin;
+        return cfg;
+    }
+};
+
+struct ProfileTable{
+    static constexpr uint32_t kMagic = 0x50524F46;   // "PROF"
+    static constexpr uint16_t kVersion = 1;
+    static constexpr uint8_t kMaxProfiles = 8;
+
+    uint32_t magic {kMagic};
+    uint16_t version {kVersion};
+    uint8_t count {0};
+    uint8_t reserved {0};
+    std::array<MotionProfile, kMaxProfiles> profiles {};
+    uint32_t crc {0};
+    uint32_t padding {0};
+
+    [[nodiscard]] uint32_t CalcCrc() const{
+        return Crc32(this, offsetof(ProfileTable, crc));
+    }
+
+    [[nodiscard]] bool IsValid() const{
+        return magic == kMagic && version == kVersion && count > 0 && count <= kMaxProfiles && crc == CalcCrc();
+    }
+
+    // profiles built in: CONFIG1/CONFIG2 speeds x kParabolic/kConstantPower, indexed like the DIP switches
+    static ProfileTable Defaults(){
+        ProfileTable table;
+        table.count = 4;
+        table.profiles[0] = {"cfg1par", utils::get_idx(MotorSpecial::AccelType::kParabolic),
+                             CONFIG1_RAMP_TIME, CONFIG1_ACCELERATION, CONFIG1_MAX_SPEED, INITIAL_SPEED};
+        table.profiles[1] = {"cfg1pow", utils::get_idx(MotorSpecial::AccelType::kConstantPower),
+                             CONFIG1_RAMP_TIME, CONFIG1_ACCELERATION, CONFIG1_MAX_SPEED, INITIAL_SPEED};
+        table.profiles[2] = {"cfg2par", utils::get_idx(MotorSpecial::AccelType::kParabolic),
+                             CONFIG2_RAMP_TIME, CONFIG2_ACCELERATION, CONFIG2_MAX_SPEED, INITIAL_SPEED};
+        table.profiles[3] = {"cfg2pow", utils::get_idx(MotorSpecial::AccelType::kConstantPower),
+                             CONFIG2_RAMP_TIME, CONFIG2_ACCELERATION, CONFIG2_MAX_SPEED, INITIAL_SPEED};
+        table.crc = table.CalcCrc();
+        return table;
+    }
+
+    static uint32_t Crc32(const void* data, std::size_t size){
+        auto bytes = static_cast<const uint8_t*>(data);
+        uint32_t crc = 0xFFFFFFFF;
+        for(std::size_t i = 0; i < size; i++){
+            crc ^= bytes[i];
+            for(int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+    }
+};
+static_assert(sizeof(ProfileTable) % sizeof(uint64_t) == 0);
+
+// Profile table in its own flash page (PROFILES in the linker script), falls back to the
+// built in defaults when the page is blank, from another firmware version or corrupted
+// The page is programmed together with the firmware image (see RasterDriverProfileOpt),
+// the firmware only reads it.
+class ProfileStore{
+public:
+    void Load(){
+        auto stored = reinterpret_cast<const ProfileTable*>(_sprofiles);
+        table_ = stored->IsValid() ? *stored : ProfileTable::Defaults();
+    }
+
+    [[nodiscard]] const MotionProfile* Get(uint8_t idx) const{
+        if(idx >= table_.count)
+            return nullptr;
+        return &table_.profiles[idx];
+    }
+
+    [[nodiscard]] uint8_t Count() const{
+        return table_.count;
+    }
+
+private:
+    ProfileTable table_;
+};
+
+// Double buffer between the profile selection and the motor. The main loop builds the
+// requested profile into the staging slot, the control tick swaps it in only while the
+// motor is idle, so a profile never changes in the middle of a move and the work of
+// building it is never done in an interrupt.
+class ProfileBuffer{
+public:
+    struct Slot{
+        uint8_t idx;
+        AppCfg cfg;
+    };
+
+    void Request(uint8_t idx){
+        requested_idx_ = idx;
+    }
+
+    [[nodiscard]] std::optional<uint8_t> ActiveIdx() const{
+        return active_ ? std::optional<uint8_t>(slots_[*active_].idx) : std::nullopt;
+    }
+
+    void Prepare(const ProfileStore& store){
+        uint8_t idx = requested_idx_;
+        if(staged_ || idx == kNoRequest || ActiveIdx() == idx)
+            return;
+        auto profile = store.Get(idx);
+        if(!profile || !profile->IsValid()){
+            requested_idx_ = kNoRequest;
+            return;
+        }
+        auto& slot = slots_[StagingIdx()];
+        slot.idx = idx;
+        slot.cfg = profile->MakeAppConfig();
+        // the slot is complete before the control tick can see staged_
+        std::atomic_signal_fence(std::memory_order_release);
+        staged_ = true;
+    }
+
+    const Slot* Swap(){
+        if(!staged_)
+            return nullptr;
+        std::atomic_signal_fence(std::memory_order_acquire);
+        active_ = StagingIdx();
+        staged_ = false;
+        return &slots_[*active_];
+    }
+
+private:
+    static constexpr uint8_t kNoRequest = UINT8_MAX;
+
+    std::array<Slot, 2> slots_ {Slot{0, getBaseConfig()}, Slot{0, getBaseConfig()}};
+    std::optional<uint8_t> active_;
+    volatile uint8_t requested_idx_ {kNoRequest};
+    volatile bool staged_ {false};
+
+    [[nodiscard]] uint8_t StagingIdx() const{
+        return active_ ? 1 - *active_ : 0;
+    }
+};
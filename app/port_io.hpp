@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+
+#include "main.h"
+#include "app_config.hpp"
+
+// Per bit debounce of a whole port word with a 2 bit vertical counter: a bit takes the
+// new level after 4 consecutive samples that differ from the debounced state.
+class VerticalDebouncer{
+public:
+    void Reset(uint32_t state){
+        state_ = state;
+        cnt0_ = cnt1_ = 0;
+    }
+
+    // returns the bits that toggled with this sample
+    uint32_t Update(uint32_t sample){
+        uint32_t delta = sample ^ state_;
+        cnt1_ = (cnt1_ ^ cnt0_) & delta;
+        cnt0_ = ~cnt0_ & delta;
+        uint32_t toggle = delta & ~(cnt0_ | cnt1_);
+        state_ ^= toggle;
+        return toggle;
+    }
+
+    [[nodiscard]] uint32_t State() const{
+        return state_;
+    }
+
+private:
+    uint32_t state_ {0};
+    uint32_t cnt0_ {0};
+    uint32_t cnt1_ {0};
+};
+
+// All inputs sit on GPIOA: IDR is read once per control tick and debounced in parallel.
+// Limit switches, exp_req and the buttons are sampled every tick, the DIP switches every
+// kDipDivider ticks so they settle in about DIP_DEBOUNCE_TICKS.
+class PortInputs{
+public:
+    static constexpr uint32_t kDipMask = CONFIG_1_Pin | CONFIG_2_Pin | CONFIG_3_Pin;
+    static constexpr uint32_t kFastMask = EXP_REQ_IN_Pin | GRID_HOME_DETECT_Pin | GRID_INFIELD_DETECT_Pin
+                                        | GRID_BUTTON_Pin | NOTUSED_PUSHBUTTON_Pin;
+
+    void SetInverted(uint32_t mask){
+        inverted_ |= mask;
+    }
+
+    void Init(){
+        auto sample = Sample();
+        sample_ = sample;
+        fast_.Reset(sample & kFastMask);
+        dip_.Reset(sample & kDipMask);
+        rise_ = fall_ = 0;
+        divider_ = 0;
+    }
+
+    void Update(){
+        auto sample = Sample();
+        sample_ = sample;
+        uint32_t toggle = fast_.Update(sample & kFastMask);
+        if(++divider_ >= kDipDivider){
+            divider_ = 0;
+            toggle |= dip_.Update(sample & kDipMask);
+        }
+        auto state = State();
+        rise_ = toggle & state;
+        fall_ = toggle & ~state;
+    }
+
+    [[nodiscard]] uint32_t State() const{
+        return fast_.State() | dip_.State();
+    }
+
+    // pin levels of the last Update(), before inversion and debouncing
+    [[nodiscard]] uint32_t Raw() const{
+        return sample_ ^ (inverted_ & (kFastMask | kDipMask));
+    }
+
+    [[nodiscard]] bool IsHigh(uint32_t mask) const{
+        return State() & mask;
+    }
+
+    // edges of the last Update()
+    [[nodiscard]] uint32_t Rise() const{
+        return rise_;
+    }
+
+    [[nodiscard]] uint32_t Fall() const{
+        return fall_;
+    }
+
+    [[nodiscard]] bool Changed(uint32_t mask) const{
+        return (rise_ | fall_) & mask;
+    }
+
+private:
+    static constexpr uint16_t kDipDivider = (DIP_DEBOUNCE_TICKS + 3) / 4;
+
+    VerticalDebouncer fast_;
+    VerticalDebouncer dip_;
+    uint32_t inverted_ {0};
+    uint32_t sample_ {0};
+    uint32_t rise_ {0};
+    uint32_t fall_ {0};
+    uint16_t divider_ {0};
+
+    [[nodiscard]] uint32_t Sample() const{
+        return (GPIOA->IDR ^ inverted_) & (kFastMask | kDipMask);
+    }
+};
+
+// GPIOA outputs collected during the control tick and applied with one BSRR write
+class PortOutputs{
+public:
+    void Set(uint32_t mask, bool high){
+        if(high){
+            set_ |= mask;
+            reset_ &= ~mask;
+        }else{
+            reset_ |= mask;
+            set_ &= ~mask;
+        }
+    }
+
+    void Apply(){
+        if(!(set_ | reset_))
+            return;
+        GPIOA->BSRR = set_ | (reset_ << 16);
+        set_ = reset_ = 0;
+    }
+
+private:
+    uint32_t set_ {0};
+    uint32_t reset_ {0};
+};
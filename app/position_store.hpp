@@ -0,0 +1,104 @@
+#pragma once
+
+#include "app_config.hpp"
+#include "backup_registers.hpp"
+#include "deadline_monitor.hpp"
+#include "flash_journal.hpp"
+
+// Last known grid State and calibrated travel range. Every change goes to the backup
+// registers (survives warm reset), rest states and the range are also journaled in flash
+// (survives power cycle). Flash is written from the main loop by Flush(), never from the
+// control tick. A full journal is compacted only with the motor idle and the deadline
+// monitor masked: the page erase holds off the control tick, which runs from flash.
+class PositionStore{
+public:
+    enum class Key : uint8_t{
+        grid_state = 0,
+        travel_range = 1,
+    };
+
+    enum class Source{
+        backup_registers,
+        flash_journal
+    };
+
+    struct Record{
+        RBTypes::State state;
+        Source source;
+    };
+
+    void Init(){
+        BackupRegisters::Init();
+    }
+
+    void Save(RBTypes::State state){
+        Write(Key::grid_state, utils::get_idx(state), IsRestState(state));
+    }
+
+    void SaveTravelRange(uint32_t steps){
+        Write(Key::travel_range, steps, true);
+    }
+
+    [[nodiscard]] std::optional<Record> Restore() const{
+        if(auto value = BackupRegisters::Read(utils::get_idx(Key::grid_state)); value && IsRestState(*value))
+            return Record{static_cast<RBTypes::State>(*value), Source::backup_registers};
+        if(auto value = journal_.Read(utils::get_idx(Key::grid_state)); value && IsRestState(*value))
+            return Record{static_cast<RBTypes::State>(*value), Source::flash_journal};
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::optional<uint32_t> TravelRange() const{
+        if(auto value = BackupRegisters::Read(utils::get_idx(Key::travel_range)))
+            return value;
+        return journal_.Read(utils::get_idx(Key::travel_range));
+    }
+
+    void Flush(bool motor_idle){
+        if(!motor_idle)
+            return;
+        for(uint8_t key = 0; key < kKeysCnt; key++){
+            uint32_t value = TakePending(key);
+            if(value == kNoPending)
+                continue;
+            if(!journal_.IsFull()){
+                journal_.Append(key, value);
+                continue;
+            }
+            Deadlines::Mask();
+            journal_.Append(key, value);
+            Deadlines::Unmask();
+        }
+    }
+
+private:
+    static constexpr uint8_t kKeysCnt = 2;
+    static constexpr uint32_t kNoPending = UINT32_MAX;
+
+    FlashJournal journal_;
+    volatile uint32_t pending_[kKeysCnt] {kNoPending, kNoPending};
+
+    // Save() runs in the control tick
+    uint32_t TakePending(uint8_t key){
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint32_t value = pending_[key];
+        pending_[key] = kNoPending;
+        __set_PRIMASK(primask);
+        return value;
+    }
+
+    void Write(Key key, uint32_t value, bool journaled){
+        BackupRegisters::Write(utils::get_idx(key), value);
+        if(journaled)
+            pending_[utils::get_idx(key)] = value;
+    }
+
+    static bool IsRestState(uint32_t value){
+        return value == utils::get_idx(RBTypes::State::grid_home)
+            || value == utils::get_idx(RBTypes::State::grid_in_field);
+    }
+
+    static bool IsRestState(RBTypes::State state){
+        return IsRestState(utils::get_idx(state));
+    }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+
+#include "iwdg.h"
+#include "can_telemetry.hpp"
+#include "cycle_counter.hpp"
+#include "motion_profiles.hpp"
+
+// Cost of AccelMotor::MotorRefresh() per AccelType, DIP speed set and ramp phase.
+// The motor is a second AccelMotor on the spare NOTUSED outputs and TIM3, its PWM is stopped
+// right after the task is made, so MotorRefresh() is called back to back from Run() and
+// nothing reaches the driver. Same code is timed on the host by bench/refresh_bench.cpp.
+struct RefreshBench{
+    enum class Phase : uint8_t{
+        accel,
+        cruise,
+        decel,
+        count
+    };
+
+    static constexpr std::size_t kTypeCount = utils::get_idx(MotorSpecial::AccelType::kSigmoid) + 1;
+    // ProfileTable::Defaults indices of the CONFIG1 and CONFIG2 speeds
+    static constexpr std::array<uint8_t, 2> kSpeedSets{0, 2};
+    static constexpr uint32_t kMoveSteps = STEPS_BEFORE_DECCEL;
+
+    class Motor : public MotorSpecial::AccelMotor{
+    public:
+        explicit Motor(const MotorSpecial::AccelCfg& cfg)
+            :AccelMotor(cfg)
+            ,cfg_(cfg)
+        {}
+
+        void Start(uint32_t steps = kMoveSteps){
+            MakeMotorTask(cfg_.Vmin, cfg_.Vmax, StepperMotor::Direction::FORWARD, steps);
+            HAL_TIM_PWM_Stop_IT(cfg_.stepper_cfg.htim, cfg_.stepper_cfg.channel);
+        }
+
+        [[nodiscard]] Phase CurrentPhase(){
+            switch(CurrentMoveMode()){
+                case StepperMotor::ACCEL:
+                    return Phase::accel;
+                case StepperMotor::DECCEL:
+                    return Phase::decel;
+                default:
+                    return Phase::cruise;
+            }
+        }
+
+    private:
+        void AppCorrection() override{}
+
+        MotorSpecial::AccelCfg cfg_;
+    };
+
+    static MotorSpecial::AccelCfg Config(MotorSpecial::AccelType type, std::size_t speed_set){
+        auto cfg = ProfileTable::Defaults().profiles[kSpeedSets[speed_set]].MakeAppConfig().accelCfg;
+        cfg.accel_type = type;
+        cfg.stepper_cfg = {
+            pin_board::PIN<pin_board::Writeable>{NOTUSED_0_OUT_GPIO_Port, NOTUSED_0_OUT_Pin},
+            pin_board::PIN<pin_board::Writeable>{NOTUSED_1_OUT_GPIO_Port, NOTUSED_1_OUT_Pin},
+            pin_board::PIN<pin_board::Writeable>{NOTUSED_1_OUT_GPIO_Port, NOTUSED_1_OUT_Pin},
+            &htim3,
+            TIM_CHANNEL_2,
+            TOTAL_RANGE_STEPS
+        };
+        return cfg;
+    }
+
+    // one full move per AccelType and speed set, before the control tick is started
+    static void Run(){
+        for(std::size_t type = 0; type < kTypeCount; type++){
+            for(std::size_t set = 0; set < kSpeedSets.size(); set++){
+                Motor motor{Config(static_cast<MotorSpecial::AccelType>(type), set)};
+                auto& result = results_[type][set];
+                motor.Start();
+                for(uint32_t step = 0; step < kMoveSteps && motor.IsMotorMoving(); step++){
+                    auto phase = utils::get_idx(motor.CurrentPhase());
+                    uint32_t primask = __get_PRIMASK();
+                    __disable_irq();
+                    auto start = CycleCounter::Now();
+                    motor.MotorRefresh();
+                    auto cycles = CycleCounter::Now() - start;
+                    __set_PRIMASK(primask);
+                    result[phase].Add(cycles);
+                }
+                motor.StopMotor();
+                HAL_IWDG_Refresh(&hiwdg);
+            }
+        }
+    }
+
+    // CanTelemetry::Msg::refresh_bench, one frame per result while the queue has room,
+    // cycle counts above 0xFFFF are reported as 0xFFFF
+    static void Report(CanTelemetry& telemetry){
+        constexpr auto kPhases = utils::get_idx(Phase::count);
+        constexpr auto kResults = kTypeCount * kSpeedSets.size() * kPhases;
+        while(reported_ < kResults && telemetry.Free()){
+            auto phase = reported_ % kPhases;
+            auto set = reported_ / kPhases % kSpeedSets.size();
+            auto type = reported_ / kPhases / kSpeedSets.size();
+            auto& stats = results_[type][set][phase];
+            telemetry.Queue(CanTelemetry::Msg::refresh_bench, {
+                static_cast<uint8_t>(type), static_cast<uint8_t>(set), static_cast<uint8_t>(phase),
+                static_cast<uint8_t>(std::min<uint32_t>(stats.count, 0xFF)),
+                static_cast<uint8_t>(Saturate(stats.Average())), static_cast<uint8_t>(Saturate(stats.Average()) >> 8),
+                static_cast<uint8_t>(Saturate(stats.max)), static_cast<uint8_t>(Saturate(stats.max) >> 8)
+            });
+            reported_++;
+        }
+    }
+
+private:
+    static uint16_t Saturate(uint32_t cycles){
+        return static_cast<uint16_t>(std::min<uint32_t>(cycles, 0xFFFF));
+    }
+
+    using PhaseStats = std::array<CycleStats, utils::get_idx(Phase::count)>;
+
+    static inline std::array<std::array<PhaseStats, kSpeedSets.size()>, kTypeCount> results_ {};
+    static inline std::size_t reported_ {0};
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Statically allocated storage for a singleton that is constructed explicitly in AppInit().
+// The storage itself is constant-initialized, so access from an ISR is a plain address
+// without the guard check of a function-local static.
+template<typename T>
+class StaticInstance{
+public:
+    constexpr StaticInstance() = default;
+    StaticInstance(const StaticInstance&) = delete;
+    StaticInstance& operator=(const StaticInstance&) = delete;
+
+    template<typename... Args>
+    T& Construct(Args&&... args){
+        return *::new(static_cast<void*>(storage_)) T(std::forward<Args>(args)...);
+    }
+
+    T& operator*(){
+        return *std::launder(reinterpret_cast<T*>(storage_));
+    }
+
+    T* operator->(){
+        return std::launder(reinterpret_cast<T*>(storage_));
+    }
+
+private:
+    alignas(T) std::byte storage_[sizeof(T)] {};
+};
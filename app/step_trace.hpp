@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Step timing trace, written by the simulator and readable on the host with StepTraceDecoder.
+// Header: "RDST", u16 version, u16 reserved, u64 start time (ns), little endian.
+// Records are LEB128 varints, times are in ns:
+//   step:   tag = zigzag(period - previous period) << 2 | dir << 1
+//   event:  tag = kind << 1 | 1, dt from the last step, index, zigzag(value)
+// Steady motion costs one byte per step. Nothing here allocates, so the encoder can fill
+// a RAM buffer on the target as well.
+struct StepTrace{
+    static constexpr uint32_t kMagic = 0x54534452; // "RDST"
+    static constexpr uint16_t kVersion = 1;
+    static constexpr std::size_t kHeaderSize = 16;
+    // longest record: tag + dt + index + value
+    static constexpr std::size_t kMaxRecordSize = 10 + 10 + 5 + 5;
+
+    enum class Kind : uint8_t{
+        step = 0,
+        state = 1,      // index: RBTypes::State, value: absolute position
+        mark = 2,       // free for captures, e.g. exposure request edges
+    };
+
+    struct Record{
+        Kind kind;
+        uint64_t time;
+        int8_t dir;         // step: +1 / -1
+        uint32_t index;
+        int32_t value;
+    };
+
+    static constexpr uint64_t ZigZag(int64_t v){
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static constexpr int64_t UnZigZag(uint64_t v){
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+};
+
+class StepTraceEncoder{
+public:
+    StepTraceEncoder(uint8_t* buffer, std::size_t size)
+        :buffer_(buffer)
+        ,size_(size)
+    {}
+
+    bool Begin(uint64_t start_time){
+        if(size_ < StepTrace::kHeaderSize)
+            return false;
+        Put32(StepTrace::kMagic);
+        Put16(StepTrace::kVersion);
+        Put16(0);
+        Put32(static_cast<uint32_t>(start_time));
+        Put32(static_cast<uint32_t>(start_time >> 32));
+        last_step_ = start_time;
+        return true;
+    }
+
+    bool Step(uint64_t time, bool forward){
+        if(!HasRoom())
+            return false;
+        auto period = static_cast<int64_t>(time - last_step_);
+        PutVarint(StepTrace::ZigZag(period - period_) << 2 | (forward ? 0 : 2));
+        period_ = period;
+        last_step_ = time;
+        return true;
+    }
+
+    bool Event(StepTrace::Kind kind, uint64_t time, uint32_t index, int32_t value){
+        if(!HasRoom())
+            return false;
+        PutVarint(static_cast<uint64_t>(kind) << 1 | 1);
+        PutVarint(time - last_step_);
+        PutVarint(index);
+        PutVarint(StepTrace::ZigZag(value));
+        return true;
+    }
+
+    [[nodiscard]] std::size_t Size() const{ return pos_; }
+    // hands the buffer back after its content was stored, the step and period state is kept
+    void Drain(){ pos_ = 0; }
+
+private:
+    [[nodiscard]] bool HasRoom() const{
+        return size_ - pos_ >= StepTrace::kMaxRecordSize;
+    }
+
+    void PutVarint(uint64_t v){
+        while(v >= 0x80){
+            buffer_[pos_++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        buffer_[pos_++] = static_cast<uint8_t>(v);
+    }
+
+    void Put16(uint16_t v){
+        buffer_[pos_++] = static_cast<uint8_t>(v);
+        buffer_[pos_++] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void Put32(uint32_t v){
+        Put16(static_cast<uint16_t>(v));
+        Put16(static_cast<uint16_t>(v >> 16));
+    }
+
+    uint8_t* buffer_;
+    std::size_t size_;
+    std::size_t pos_ {0};
+    uint64_t last_step_ {0};
+    int64_t period_ {0};
+};
+
+class StepTraceDecoder{
+public:
+    StepTraceDecoder(const uint8_t* data, std::size_t size)
+        :data_(data)
+        ,size_(size)
+    {
+        valid_ = size_ >= StepTrace::kHeaderSize && Get32(0) == StepTrace::kMagic
+                 && Get16(4) == StepTrace::kVersion;
+        if(valid_){
+            last_step_ = Get32(8) | static_cast<uint64_t>(Get32(12)) << 32;
+            pos_ = StepTrace::kHeaderSize;
+        }
+    }
+
+    // false when the header is wrong or the data ends inside a record
+    [[nodiscard]] bool IsValid() const{ return valid_; }
+
+    bool Next(StepTrace::Record& record){
+        if(!valid_ || pos_ == size_)
+            return false;
+        uint64_t tag;
+        if(!GetVarint(tag))
+            return false;
+        if(!(tag & 1)){
+            period_ += StepTrace::UnZigZag(tag >> 2);
+            last_step_ += period_;
+            record = {StepTrace::Kind::step, last_step_, static_cast<int8_t>(tag & 2 ? -1 : 1), 0, 0};
+            return true;
+        }
+        uint64_t dt, index, value;
+        if(!GetVarint(dt) || !GetVarint(index) || !GetVarint(value))
+            return false;
+        record = {static_cast<StepTrace::Kind>(tag >> 1), last_step_ + dt, 0,
+                  static_cast<uint32_t>(index), static_cast<int32_t>(StepTrace::UnZigZag(value))};
+        return true;
+    }
+
+private:
+    bool GetVarint(uint64_t& v){
+        v = 0;
+        for(uint8_t shift = 0; shift < 64; shift += 7){
+            if(pos_ == size_)
+                break;
+            auto byte = data_[pos_++];
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if(!(byte & 0x80))
+                return true;
+        }
+        valid_ = false;
+        return false;
+    }
+
+    [[nodiscard]] uint16_t Get16(std::size_t at) const{
+        return static_cast<uint16_t>(data_[at] | data_[at + 1] << 8);
+    }
+
+    [[nodiscard]] uint32_t Get32(std::size_t at) const{
+        return Get16(at) | static_cast<uint32_t>(Get16(at + 2)) << 16;
+    }
+
+    const uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_ {0};
+    bool valid_;
+    uint64_t last_step_ {0};
+    int64_t period_ {0};
+};
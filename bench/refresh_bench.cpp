@@ -0,0 +1,115 @@
+// MotorRefresh() per AccelType, DIP speed set and ramp phase, the host side of RefreshBench.
+// Time per iteration is ns/step in that phase, worst_ns the slowest single step of a full move.
+// An AccelMotor that steps every type identically does not implement the types, the type
+// axis is then dropped instead of timing the same ramp four times under different names.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "tim.h"
+#include "refresh_bench.hpp"
+
+namespace{
+    using Phase = RefreshBench::Phase;
+
+    // runs the move up to the first step of phase, false if the move has none
+    bool StartAt(RefreshBench::Motor& motor, Phase phase){
+        motor.Start();
+        for(uint32_t step = 0; step < RefreshBench::kMoveSteps && motor.IsMotorMoving(); step++){
+            if(motor.CurrentPhase() == phase)
+                return true;
+            motor.MotorRefresh();
+        }
+        return false;
+    }
+
+    double WorstStepNs(RefreshBench::Motor& motor, Phase phase){
+        using Clock = std::chrono::steady_clock;
+        std::chrono::nanoseconds worst{0};
+        motor.Start();
+        for(uint32_t step = 0; step < RefreshBench::kMoveSteps && motor.IsMotorMoving(); step++){
+            bool in_phase = motor.CurrentPhase() == phase;
+            auto start = Clock::now();
+            motor.MotorRefresh();
+            auto took = Clock::now() - start;
+            if(in_phase && took > worst)
+                worst = std::chrono::duration_cast<std::chrono::nanoseconds>(took);
+        }
+        return static_cast<double>(worst.count());
+    }
+
+    // step timer reload values of a whole move
+    std::vector<uint32_t> Ramp(MotorSpecial::AccelType type, std::size_t speed_set){
+        RefreshBench::Motor motor{RefreshBench::Config(type, speed_set)};
+        std::vector<uint32_t> ramp;
+        motor.Start();
+        for(uint32_t step = 0; step < RefreshBench::kMoveSteps && motor.IsMotorMoving(); step++){
+            ramp.push_back(uint32_t{htim3.Instance->ARR});
+            motor.MotorRefresh();
+        }
+        return ramp;
+    }
+
+    bool TypesDistinct(){
+        for(std::size_t set = 0; set < RefreshBench::kSpeedSets.size(); set++){
+            auto first = Ramp(MotorSpecial::AccelType{}, set);
+            for(std::size_t type = 1; type < RefreshBench::kTypeCount; type++){
+                if(Ramp(static_cast<MotorSpecial::AccelType>(type), set) != first)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void BM_MotorRefresh(benchmark::State& state){
+        auto type = static_cast<MotorSpecial::AccelType>(state.range(0));
+        auto phase = static_cast<Phase>(state.range(2));
+        RefreshBench::Motor motor{RefreshBench::Config(type, state.range(1))};
+        if(!StartAt(motor, phase)){
+            state.SkipWithError("phase not reached");
+            return;
+        }
+        for(auto _ : state){
+            if(!motor.IsMotorMoving() || motor.CurrentPhase() != phase){
+                state.PauseTiming();
+                StartAt(motor, phase);
+                state.ResumeTiming();
+            }
+            motor.MotorRefresh();
+        }
+        state.counters["worst_ns"] = WorstStepNs(motor, phase);
+    }
+}
+
+extern "C" void Error_Handler(void){
+    std::fprintf(stderr, "bench: Error_Handler\n");
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv){
+    // the timer handles the motor writes to
+    MX_TIM3_Init();
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv))
+        return EXIT_FAILURE;
+    auto types = static_cast<int64_t>(RefreshBench::kTypeCount);
+    if(!TypesDistinct()){
+        std::fprintf(stderr, "bench: every AccelType steps identically, the AccelMotor built in ignores accel_type;\n"
+                             "       timing type 0 only, rebuild against the embedded_hw_utils submodule for per-type results\n");
+        benchmark::AddCustomContext("accel_types", "not implemented by the AccelMotor built in, type 0 only");
+        types = 1;
+    }
+    benchmark::RegisterBenchmark("BM_MotorRefresh", BM_MotorRefresh)
+        ->ArgNames({"type", "speed_set", "phase"})
+        ->ArgsProduct({
+            benchmark::CreateDenseRange(0, types - 1, 1),
+            benchmark::CreateDenseRange(0, RefreshBench::kSpeedSets.size() - 1, 1),
+            benchmark::CreateDenseRange(0, utils::get_idx(Phase::count) - 1, 1),
+        });
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,33 @@
+# Host microbenchmarks of app/ code, built against the sim board model (cmake/sim.cmake)
+
+find_package(benchmark QUIET)
+if(NOT benchmark_FOUND)
+    include(FetchContent)
+
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+    FetchContent_Declare(
+        googlebenchmark
+        GIT_REPOSITORY https://github.com/google/benchmark.git
+        GIT_TAG main
+    )
+
+    FetchContent_MakeAvailable(googlebenchmark)
+endif()
+
+file(GLOB_RECURSE bench_sources CONFIGURE_DEPENDS
+        ${PROJECT_SOURCE_DIR}/bench/*.cpp
+)
+
+set(BENCH_TARGET ${PROJECT_NAME}Bench)
+
+add_executable(${BENCH_TARGET}
+        ${bench_sources}
+        $<TARGET_OBJECTS:${SIM_HW_TARGET}>
+)
+
+sim_target_setup(${BENCH_TARGET})
+
+target_link_libraries(${BENCH_TARGET}
+        PRIVATE
+        benchmark::benchmark
+)
@@ -1,32 +1,36 @@
+# Host unit tests of app/ code, built against the sim board model (cmake/sim.cmake)
 
-include(FetchContent)
+find_package(GTest QUIET)
+if(NOT GTest_FOUND)
+    include(FetchContent)
 
-FetchContent_Declare(
-    googletest
-    GIT_REPOSITORY https://github.com/google/googletest.git
-    GIT_TAG main
-)
-
-FetchContent_MakeAvailable(googletest)
+    FetchContent_Declare(
+        googletest
+        GIT_REPOSITORY https://github.com/google/googletest.git
+        GIT_TAG main
+    )
 
-enable_testing()
+    FetchContent_MakeAvailable(googletest)
+endif()
 
 include(GoogleTest)
 
 file(GLOB_RECURSE test_sources CONFIGURE_DEPENDS
-        ${PROJECT_SOURCE_DIR}/tests/*.*
+        ${PROJECT_SOURCE_DIR}/tests/*.cpp
 )
 
-add_executable(${PROJECT_NAME}Test ${test_sources})
+set(TEST_TARGET ${PROJECT_NAME}Test)
 
-target_link_libraries(${PROJECT_NAME}Test
-        PUBLIC
-        GTest::gtest_main
-        GTest::gmock_main
+add_executable(${TEST_TARGET}
+        ${test_sources}
+        $<TARGET_OBJECTS:${SIM_HW_TARGET}>
 )
 
-include_directories(
-    ${CMAKE_CURRENT_BINARY_DIR}/_deps/googletest-src/googlemock/include
+sim_target_setup(${TEST_TARGET})
+
+target_link_libraries(${TEST_TARGET}
+        PRIVATE
+        GTest::gtest_main
 )
 
-gtest_discover_tests(${PROJECT_NAME}Test)
\ No newline at end of file
+gtest_discover_tests(${TEST_TARGET})
@@ -0,0 +1,298 @@
+
+# Host simulation of the board, app/ and the CubeMX peripheral init are built unchanged
+# against the HAL stand-in in sim/hal
+
+set(SIM_TARGET ${PROJECT_NAME}Sim)
+set(SIM_HW_TARGET ${PROJECT_NAME}SimHw)
+
+set(SIM_CORE_SOURCES
+        Core/Src/board_direct.c
+        Core/Src/boot_profile.c
+        Core/Src/fdcan.c
+        Core/Src/gpio.c
+        Core/Src/irq_latency.c
+        Core/Src/iwdg.c
+        Core/Src/stm32g4xx_it.c
+        Core/Src/tim.c
+)
+
+# board model, shared with the benchmarks
+set(SIM_HW_SOURCES
+        sim/hal/hal.cpp
+        sim/machine.cpp
+)
+
+function(sim_target_setup target)
+    # sim/hal first so its stm32g4xx_hal.h is the one Core/Inc/main.h pulls in
+    target_include_directories(${target}
+            BEFORE PRIVATE
+            ${PROJECT_SOURCE_DIR}/sim/hal
+            ${PROJECT_SOURCE_DIR}/sim
+            ${PROJECT_SOURCE_DIR}/Core/Inc
+    )
+
+    utils_target_include_dir_recurse(${target} ${PRJ_DIRS})
+
+    set_target_properties(${target}
+            PROPERTIES
+            C_STANDARD 11
+            C_EXTENSIONS ON
+            CXX_STANDARD 23
+            CXX_EXTENSIONS ON
+            POSITION_INDEPENDENT_CODE OFF
+    )
+
+    target_compile_options(${target}
+            PRIVATE
+            $<$<COMPILE_LANGUAGE:CXX>:-Wno-volatile>
+    )
+
+    # the linker script symbols, flash is mapped at FLASH_BASE by sim::Machine::MapFlash()
+    target_link_options(${target}
+            PRIVATE
+            -no-pie
+            -Wl,--defsym=_sprofiles=0x0801F000
+            -Wl,--defsym=_sjournal=0x0801F800
+            -Wl,--defsym=_ejournal=0x08020000
+    )
+endfunction()
+
+add_library(${SIM_HW_TARGET} OBJECT ${SIM_CORE_SOURCES} ${SIM_HW_SOURCES})
+sim_target_setup(${SIM_HW_TARGET})
+
+add_executable(${SIM_TARGET})
+
+utils_add_to_sources(${SIM_TARGET} ${PRJ_DIRS})
+
+target_sources(${SIM_TARGET}
+        PRIVATE
+        ${SOURCES_${SIM_TARGET}}
+        sim/main.cpp
+        sim/plant.cpp
+        $<TARGET_OBJECTS:${SIM_HW_TARGET}>
+)
+
+sim_target_setup(${SIM_TARGET})
+
+# scenarios that pass or fail through the exit status of RasterDriverSim (--expect-*), run by ctest
+enable_testing()
+
+# a 5 ms main loop stall misses 4 control ticks in a row, DEADLINE_STOP_MISSED stops the board
+add_test(NAME sim_deadline_stall
+        COMMAND ${SIM_TARGET} --ms 500 --stall 300:5000 --expect-state error)
+# safe stop while scanning (exp_req is active low): the error drops in_motion
+add_test(NAME sim_deadline_stop_in_motion
+        COMMAND ${SIM_TARGET} --ms 1500 --set 0:exp_req=0 --stall 900:5000 --set 1100:exp_req=1
+                --expect-state error --expect-pin in_motion=0)
+# a 3 ms stall misses 2 ticks: counted, below the stop threshold
+add_test(NAME sim_deadline_counted_stall
+        COMMAND ${SIM_TARGET} --ms 500 --set 0:exp_req=0 --stall 300:3000 --expect-state scanning)
+# a stall shorter than the tick period delays one tick and misses none
+add_test(NAME sim_deadline_short_stall
+        COMMAND ${SIM_TARGET} --ms 500 --set 0:exp_req=0 --stall 300:600 --expect-state scanning)
+# stall during the boot run out move: the move queued after it must not start
+add_test(NAME sim_deadline_safe_stop
+        COMMAND ${SIM_TARGET} --ms 1500 --plant --stall 100:5000 --expect-stopped 110 --expect-state error)
+# oscillation with the window end at the home switch edge: the leg reverses at the window
+# end before the still active switch is seen, that switch must not reverse it back into the
+# home zone (below position 0). exp_req rises during calibration, the oscillation starts
+# where calibration ends in the field
+add_test(NAME sim_expo_switch_at_window_end
+        COMMAND ${SIM_TARGET} --ms 1500 --plant --plant-set field_edge=144 --plant-set hard_stop_margin=400
+                --set 0:config2=1 --set 450:exp_req=0 --expect-range -10:400)
+# exp_req active when homing ends: calibration is not started, the grid stays out of the field
+add_test(NAME sim_no_calibration_during_expo
+        COMMAND ${SIM_TARGET} --ms 1500 --plant --plant-set field_edge=200 --set 0:exp_req=0
+                --expect-state scanning --expect-range -10:250)
+# profile selected over CAN (CanTelemetry::Cmd::select_profile) replaces the DIP profile 3
+# once the motor is idle, an index past the profile table is ignored
+add_test(NAME sim_can_select_profile
+        COMMAND ${SIM_TARGET} --ms 500 --can 300:640:00 --expect-can 605:00)
+add_test(NAME sim_can_select_invalid_profile
+        COMMAND ${SIM_TARGET} --ms 500 --can 300:640:09 --expect-can 605:03)
+
+# host tools working on simulator output
+set(TRACE_DIFF_TARGET ${PROJECT_NAME}TraceDiff)
+
+add_executable(${TRACE_DIFF_TARGET} ${PROJECT_SOURCE_DIR}/sim/tools/trace_diff.cpp)
+
+target_include_directories(${TRACE_DIFF_TARGET}
+        PRIVATE
+        ${PROJECT_SOURCE_DIR}/sim
+        ${PROJECT_SOURCE_DIR}/app
+)
+
+set_target_properties(${TRACE_DIFF_TARGET}
+        PROPERTIES
+        CXX_STANDARD 23
+        CXX_EXTENSIONS ON
+)
+
+# step interval tables of AccelMotor, meant to replace accel_count.xlsx once generated
+set(RAMP_GEN_TARGET ${PROJECT_NAME}RampGen)
+
+add_executable(${RAMP_GEN_TARGET}
+        ${PROJECT_SOURCE_DIR}/sim/tools/ramp_gen.cpp
+        $<TARGET_OBJECTS:${SIM_HW_TARGET}>
+)
+
+sim_target_setup(${RAMP_GEN_TARGET})
+
+# every AccelType on both DIP speed sets side by side, profile_report writes the summary and
+# the per step CSV to the build directory
+set(PROFILE_REPORT_TARGET ${PROJECT_NAME}ProfileReport)
+
+add_executable(${PROFILE_REPORT_TARGET}
+        ${PROJECT_SOURCE_DIR}/sim/tools/profile_report.cpp
+        $<TARGET_OBJECTS:${SIM_HW_TARGET}>
+)
+
+sim_target_setup(${PROFILE_REPORT_TARGET})
+
+add_custom_target(profile_report
+        COMMAND $<TARGET_FILE:${PROFILE_REPORT_TARGET}>
+                --summary ${CMAKE_BINARY_DIR}/profile_summary.csv
+                --csv ${CMAKE_BINARY_DIR}/profile_steps.csv
+        DEPENDS ${PROFILE_REPORT_TARGET}
+        VERBATIM
+)
+
+# one table per AccelType and DIP speed set in sim/ramp, ramp_tables_check fails when the
+# firmware AccelMotor no longer produces the reviewed tables. The tables are not in the tree
+# yet, ramp_tables_update writes them from a build against the real submodule
+set(RAMP_TABLE_DIR ${PROJECT_SOURCE_DIR}/sim/ramp)
+set(RAMP_TABLE_TYPES linear parabolic constant_power sigmoid)
+set(RAMP_TABLE_SPEED_SETS cfg1 cfg2)
+set(RAMP_TABLE_PROFILE_cfg1 0)
+set(RAMP_TABLE_PROFILE_cfg2 2)
+set(RAMP_TABLE_IDENT_linear Linear)
+set(RAMP_TABLE_IDENT_parabolic Parabolic)
+set(RAMP_TABLE_IDENT_constant_power ConstantPower)
+set(RAMP_TABLE_IDENT_sigmoid Sigmoid)
+set(RAMP_TABLE_IDENT_cfg1 Cfg1)
+set(RAMP_TABLE_IDENT_cfg2 Cfg2)
+
+set(ramp_check_commands)
+set(ramp_update_commands)
+foreach(type ${RAMP_TABLE_TYPES})
+    foreach(set ${RAMP_TABLE_SPEED_SETS})
+        set(table ${RAMP_TABLE_DIR}/${type}_${set})
+        set(args --profile ${RAMP_TABLE_PROFILE_${set}} --type ${type} --name k${RAMP_TABLE_IDENT_${type}}${RAMP_TABLE_IDENT_${set}})
+        list(APPEND ramp_check_commands
+                COMMAND $<TARGET_FILE:${RAMP_GEN_TARGET}> ${args} --check ${table}.hpp
+        )
+        list(APPEND ramp_update_commands
+                COMMAND $<TARGET_FILE:${RAMP_GEN_TARGET}> ${args}
+                        --header ${table}.hpp --csv ${table}.csv --trace ${table}.rdst
+        )
+    endforeach()
+endforeach()
+
+add_custom_target(ramp_tables_check
+        ${ramp_check_commands}
+        DEPENDS ${RAMP_GEN_TARGET}
+        VERBATIM
+)
+
+add_custom_target(ramp_tables_update
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${RAMP_TABLE_DIR}
+        ${ramp_update_commands}
+        DEPENDS ${RAMP_GEN_TARGET}
+        VERBATIM
+)
+
+# the generator against the firmware stepping path: RasterDriverSim runs each ProfileTable
+# default (selected over CAN) into an oscillation, the first leg it steps must match the
+# ramp RasterDriverRampGen generates for that profile step for step
+foreach(profile 0 1 2 3)
+    set(trace ${CMAKE_CURRENT_BINARY_DIR}/ramp_firmware_${profile}.rdst)
+    add_test(NAME ramp_firmware_trace_${profile}
+            COMMAND ${SIM_TARGET} --ms 1500 --plant --plant-set field_edge=200 --set 0:config2=1 --set 450:exp_req=0
+                    --can 200:640:0${profile} --expect-can 605:0${profile} --trace ${trace})
+    set_tests_properties(ramp_firmware_trace_${profile} PROPERTIES FIXTURES_SETUP ramp_firmware_${profile})
+    add_test(NAME ramp_matches_firmware_${profile}
+            COMMAND ${RAMP_GEN_TARGET} --profile ${profile} --check-trace ${trace})
+    set_tests_properties(ramp_matches_firmware_${profile} PROPERTIES FIXTURES_REQUIRED ramp_firmware_${profile})
+endforeach()
+
+# golden step traces in sim/golden, one per scenario. sim_golden_check fails on any
+# timing drift, sim_golden_update rewrites them after an intended profile change. No traces
+# are in the tree yet: generate them with sim_golden_update from a build against the real
+# submodule before relying on sim_golden_check
+set(SIM_GOLDEN_DIR ${PROJECT_SOURCE_DIR}/sim/golden)
+set(SIM_GOLDEN_SCENARIOS
+        home_dip1
+        home_dip0
+        expo_dip2
+)
+set(SIM_GOLDEN_home_dip1 --ms 3000 --set 0:config1=1 --set 200:button=1 --set 400:button=0)
+set(SIM_GOLDEN_home_dip0 --ms 3000 --set 200:button=1 --set 400:button=0)
+# calibration against the grid model, then oscillation legs at the speed of the DIP profile
+set(SIM_GOLDEN_expo_dip2 --ms 1500 --plant --plant-set field_edge=200 --set 0:config2=1 --set 450:exp_req=0)
+
+set(golden_check_commands)
+set(golden_update_commands)
+foreach(scenario ${SIM_GOLDEN_SCENARIOS})
+    set(trace ${CMAKE_CURRENT_BINARY_DIR}/golden/${scenario}.rdst)
+    list(APPEND golden_check_commands
+            COMMAND $<TARGET_FILE:${SIM_TARGET}> ${SIM_GOLDEN_${scenario}} --trace ${trace} > /dev/null
+            COMMAND $<TARGET_FILE:${TRACE_DIFF_TARGET}> ${SIM_GOLDEN_DIR}/${scenario}.rdst ${trace}
+    )
+    list(APPEND golden_update_commands
+            COMMAND $<TARGET_FILE:${SIM_TARGET}> ${SIM_GOLDEN_${scenario}} --trace ${SIM_GOLDEN_DIR}/${scenario}.rdst > /dev/null
+    )
+endforeach()
+
+add_custom_target(sim_golden_check
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${CMAKE_CURRENT_BINARY_DIR}/golden
+        ${golden_check_commands}
+        DEPENDS ${SIM_TARGET} ${TRACE_DIFF_TARGET}
+        VERBATIM
+)
+
+add_custom_target(sim_golden_update
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${SIM_GOLDEN_DIR}
+        ${golden_update_commands}
+        DEPENDS ${SIM_TARGET}
+        VERBATIM
+)
+
+# CONFIG* speed, acceleration and ramp time sweep, runs RasterDriverSim once per candidate
+set(PROFILE_OPT_TARGET ${PROJECT_NAME}ProfileOpt)
+
+add_executable(${PROFILE_OPT_TARGET}
+        ${PROJECT_SOURCE_DIR}/sim/tools/profile_opt.cpp
+        $<TARGET_OBJECTS:${SIM_HW_TARGET}>
+)
+
+sim_target_setup(${PROFILE_OPT_TARGET})
+
+find_package(Threads REQUIRED)
+target_link_libraries(${PROFILE_OPT_TARGET} PRIVATE Threads::Threads)
+add_dependencies(${PROFILE_OPT_TARGET} ${SIM_TARGET})
+
+# end to end throughput on a fixed 1000 exposure scenario. sim_throughput appends the result
+# to SIM_THROUGHPUT_CSV and, when SIM_THROUGHPUT_MAX_SLOWDOWN is set, fails when steps/s dropped
+# by more than that fraction against the previous row, compare Release builds on the same machine
+# only. The gate is off by default, the steps/s spread it has to tolerate was only ever measured
+# against a stand-in AccelMotor and needs re-deriving with embedded_hw_utils before it is enabled
+set(SIM_BENCH_TARGET ${PROJECT_NAME}SimBench)
+
+add_executable(${SIM_BENCH_TARGET} ${PROJECT_SOURCE_DIR}/sim/tools/sim_bench.cpp)
+
+set_target_properties(${SIM_BENCH_TARGET}
+        PROPERTIES
+        CXX_STANDARD 23
+        CXX_EXTENSIONS ON
+)
+
+add_dependencies(${SIM_BENCH_TARGET} ${SIM_TARGET})
+
+set(SIM_THROUGHPUT_CSV ${CMAKE_BINARY_DIR}/sim_throughput.csv CACHE FILEPATH "History of sim_throughput results")
+set(SIM_THROUGHPUT_MAX_SLOWDOWN -1 CACHE STRING "Fraction of steps/s sim_throughput may lose against the previous run, negative only records")
+
+add_custom_target(sim_throughput
+        COMMAND sh -c "$<TARGET_FILE:${SIM_BENCH_TARGET}> --sim $<TARGET_FILE:${SIM_TARGET}> --csv ${SIM_THROUGHPUT_CSV} --max-slowdown ${SIM_THROUGHPUT_MAX_SLOWDOWN} --label $(git -C ${PROJECT_SOURCE_DIR} describe --always --dirty)"
+        DEPENDS ${SIM_BENCH_TARGET} ${SIM_TARGET}
+        VERBATIM
+)
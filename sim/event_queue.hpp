@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <vector>
+
+namespace sim{
+
+using Nanos = uint64_t;
+
+// Timeline of pending events, earliest first and in scheduling order for equal times.
+// A source (timer, SysTick, ...) has at most one pending event: Schedule() and Cancel()
+// bump its generation and the superseded entry is dropped when it reaches the top.
+// Post() adds one-shot events that are never superseded.
+class EventQueue{
+public:
+    struct Event{
+        Nanos at;
+        uint32_t source;
+        uint32_t arg;
+    };
+
+    static constexpr uint32_t kOneShot = UINT32_MAX;
+
+    explicit EventQueue(uint32_t sources)
+        :generation_(sources, 0)
+        ,pending_(sources)
+    {}
+
+    void Schedule(uint32_t source, Nanos at, uint32_t arg = 0){
+        if(pending_[source] == at)
+            return;
+        pending_[source] = at;
+        heap_.push({at, seq_++, source, ++generation_[source], arg});
+    }
+
+    void Cancel(uint32_t source){
+        if(!pending_[source])
+            return;
+        pending_[source].reset();
+        ++generation_[source];
+    }
+
+    void Post(Nanos at, uint32_t arg){
+        heap_.push({at, seq_++, kOneShot, 0, arg});
+    }
+
+    [[nodiscard]] std::optional<Nanos> Scheduled(uint32_t source) const{
+        return pending_[source];
+    }
+
+    [[nodiscard]] std::optional<Nanos> NextTime(){
+        DropStale();
+        if(heap_.empty())
+            return std::nullopt;
+        return heap_.top().at;
+    }
+
+    // earliest event at or before limit
+    std::optional<Event> Pop(Nanos limit){
+        DropStale();
+        if(heap_.empty() || heap_.top().at > limit)
+            return std::nullopt;
+        auto entry = heap_.top();
+        heap_.pop();
+        if(entry.source != kOneShot)
+            pending_[entry.source].reset();
+        return Event{entry.at, entry.source, entry.arg};
+    }
+
+private:
+    struct Entry{
+        Nanos at;
+        uint64_t seq;
+        uint32_t source;
+        uint32_t generation;
+        uint32_t arg;
+
+        bool operator>(const Entry& other) const{
+            return at != other.at ? at > other.at : seq > other.seq;
+        }
+    };
+
+    void DropStale(){
+        while(!heap_.empty()){
+            auto& top = heap_.top();
+            if(top.source == kOneShot || top.generation == generation_[top.source])
+                return;
+            heap_.pop();
+        }
+    }
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> heap_;
+    std::vector<uint32_t> generation_;
+    std::vector<std::optional<Nanos>> pending_;
+    uint64_t seq_ {0};
+};
+
+}
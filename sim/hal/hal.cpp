@@ -0,0 +1,475 @@
+// HAL and CMSIS functions of stm32g4xx_hal.h on top of the simulator, same register
+// effects as the ST implementation for the paths the firmware uses.
+#include <cstring>
+
+#include "main.h"
+#include "machine.hpp"
+
+using sim::Machine;
+
+uint32_t SystemCoreClock = sim::kCoreClockHz;
+__IO uint32_t uwTick;
+uint32_t uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+HAL_TickFreqTypeDef uwTickFreq = HAL_TICK_FREQ_DEFAULT;
+
+namespace{
+    // datasheet typical values
+    constexpr sim::Nanos kFlashPageEraseTime = 22'000'000;
+    constexpr sim::Nanos kFlashProgramTime = 82'000;
+
+    bool flash_locked = true;
+
+    uint32_t CcxE(uint32_t channel){
+        return TIM_CCER_CC1E << channel;
+    }
+
+    uint32_t CcxIE(uint32_t channel){
+        return TIM_DIER_CC1IE << (channel >> 2U);
+    }
+
+    void TimBaseConfig(TIM_HandleTypeDef* htim){
+        auto tim = htim->Instance;
+        MODIFY_REG(tim->CR1, TIM_CR1_ARPE, htim->Init.AutoReloadPreload);
+        tim->ARR = htim->Init.Period;
+        tim->PSC = htim->Init.Prescaler;
+        tim->RCR = htim->Init.RepetitionCounter;
+        tim->EGR = TIM_EGR_UG;
+        Machine::Get().SyncRegisters();
+        htim->State = HAL_TIM_STATE_READY;
+    }
+
+    void TimOCConfig(TIM_HandleTypeDef* htim, const TIM_OC_InitTypeDef* cfg, uint32_t channel, bool preload){
+        auto tim = htim->Instance;
+        auto ccmr = channel < TIM_CHANNEL_3 ? &tim->CCMR1 : &tim->CCMR2;
+        auto shift = (channel & TIM_CHANNEL_2) ? 8U : 0U;
+        auto ccmr_bits = cfg->OCMode | cfg->OCFastMode | (preload ? TIM_CCMR1_OC1PE : 0U);
+        MODIFY_REG(*ccmr, (TIM_CCMR1_OC1M | TIM_CCMR1_CC1S | TIM_CCMR1_OC1PE | TIM_CCMR1_OC1FE) << shift,
+                   ccmr_bits << shift);
+        MODIFY_REG(tim->CCER, TIM_CCER_CC1P << channel, cfg->OCPolarity << channel);
+        __HAL_TIM_SET_COMPARE(htim, channel, cfg->Pulse);
+        Machine::Get().SyncRegisters();
+    }
+
+    HAL_StatusTypeDef TimChannelStart(TIM_HandleTypeDef* htim, uint32_t channel, bool it){
+        if(it)
+            __HAL_TIM_ENABLE_IT(htim, CcxIE(channel));
+        htim->Instance->CCER |= CcxE(channel);
+        if(htim->Instance == TIM1)
+            htim->Instance->BDTR |= TIM_BDTR_MOE;
+        __HAL_TIM_ENABLE(htim);
+        Machine::Get().SyncRegisters();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef TimChannelStop(TIM_HandleTypeDef* htim, uint32_t channel, bool it){
+        if(it)
+            __HAL_TIM_DISABLE_IT(htim, CcxIE(channel));
+        htim->Instance->CCER &= ~CcxE(channel);
+        __HAL_TIM_DISABLE(htim);
+        Machine::Get().SyncRegisters();
+        return HAL_OK;
+    }
+}
+
+extern "C"
+{
+    // ------------------------------------------------------------------------ core, NVIC --
+
+    void NVIC_SetPriorityGrouping(uint32_t PriorityGroup){
+        Machine::Get().SetPriorityGrouping(PriorityGroup & 0x7U);
+    }
+
+    uint32_t NVIC_GetPriorityGrouping(void){
+        return Machine::Get().PriorityGrouping();
+    }
+
+    uint32_t NVIC_EncodePriority(uint32_t PriorityGroup, uint32_t PreemptPriority, uint32_t SubPriority){
+        uint32_t group = PriorityGroup & 0x07UL;
+        uint32_t preempt_bits = (7UL - group) > __NVIC_PRIO_BITS ? __NVIC_PRIO_BITS : 7UL - group;
+        uint32_t sub_bits = (group + __NVIC_PRIO_BITS) < 7UL ? 0UL : group - 7UL + __NVIC_PRIO_BITS;
+        return ((PreemptPriority & ((1UL << preempt_bits) - 1UL)) << sub_bits)
+             | (SubPriority & ((1UL << sub_bits) - 1UL));
+    }
+
+    void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority){
+        Machine::Get().SetPriority(IRQn, priority & ((1UL << __NVIC_PRIO_BITS) - 1UL));
+    }
+
+    uint32_t NVIC_GetPriority(IRQn_Type IRQn){
+        return Machine::Get().Priority(IRQn);
+    }
+
+    void NVIC_EnableIRQ(IRQn_Type IRQn){
+        Machine::Get().EnableIrq(IRQn, true);
+    }
+
+    void NVIC_DisableIRQ(IRQn_Type IRQn){
+        Machine::Get().EnableIrq(IRQn, false);
+    }
+
+    void NVIC_SetPendingIRQ(IRQn_Type IRQn){
+        Machine::Get().SetPendingIrq(IRQn);
+    }
+
+    void HAL_NVIC_SetPriorityGrouping(uint32_t PriorityGroup){
+        NVIC_SetPriorityGrouping(PriorityGroup);
+    }
+
+    void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority){
+        NVIC_SetPriority(IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PreemptPriority, SubPriority));
+    }
+
+    void HAL_NVIC_EnableIRQ(IRQn_Type IRQn){
+        NVIC_EnableIRQ(IRQn);
+    }
+
+    void HAL_NVIC_DisableIRQ(IRQn_Type IRQn){
+        NVIC_DisableIRQ(IRQn);
+    }
+
+    void __disable_irq(void){
+        Machine::Get().SetPrimask(1);
+    }
+
+    void __enable_irq(void){
+        Machine::Get().SetPrimask(0);
+    }
+
+    uint32_t __get_PRIMASK(void){
+        return Machine::Get().Primask();
+    }
+
+    void __set_PRIMASK(uint32_t priMask){
+        Machine::Get().SetPrimask(priMask & 1U);
+    }
+
+    HAL_StatusTypeDef HAL_Init(void){
+        HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+        uwTickPrio = TICK_INT_PRIORITY;
+        NVIC_SetPriority(SysTick_IRQn, TICK_INT_PRIORITY);
+        Machine::Get().StartSysTick();
+        return HAL_OK;
+    }
+
+    void HAL_IncTick(void){
+        uwTick += uwTickFreq;
+    }
+
+    uint32_t HAL_GetTick(void){
+        return uwTick;
+    }
+
+    void HAL_Delay(uint32_t Delay){
+        Machine::Get().Stall(Delay * sim::kNanosPerMSec);
+        uwTick += Delay;
+    }
+
+    void HAL_PWR_EnableBkUpAccess(void){}
+
+    // ------------------------------------------------------------------------------ GPIO --
+
+    void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init){
+        for(uint32_t pos = 0; pos < 16U; pos++){
+            if(!(GPIO_Init->Pin & (1UL << pos)))
+                continue;
+            if((GPIO_Init->Mode & 0x3U) == GPIO_MODE_AF_PP)
+                MODIFY_REG(GPIOx->AFR[pos >> 3U], 0xFUL << ((pos & 7U) * 4U),
+                           GPIO_Init->Alternate << ((pos & 7U) * 4U));
+            MODIFY_REG(GPIOx->MODER, 0x3UL << (pos * 2U), (GPIO_Init->Mode & 0x3U) << (pos * 2U));
+            MODIFY_REG(GPIOx->PUPDR, 0x3UL << (pos * 2U), GPIO_Init->Pull << (pos * 2U));
+        }
+        Machine::Get().SyncRegisters();
+    }
+
+    void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin){
+        for(uint32_t pos = 0; pos < 16U; pos++){
+            if(GPIO_Pin & (1UL << pos))
+                CLEAR_BIT(GPIOx->MODER, 0x3UL << (pos * 2U));
+        }
+        Machine::Get().SyncRegisters();
+    }
+
+    GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+        return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    }
+
+    void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState){
+        if(PinState != GPIO_PIN_RESET)
+            GPIOx->BSRR = GPIO_Pin;
+        else
+            GPIOx->BRR = GPIO_Pin;
+        Machine::Get().SyncRegisters();
+    }
+
+    void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+        uint32_t odr = GPIOx->ODR;
+        GPIOx->BSRR = ((odr & GPIO_Pin) << 16U) | (~odr & GPIO_Pin);
+        Machine::Get().SyncRegisters();
+    }
+
+    // ------------------------------------------------------------------------------- TIM --
+
+    __attribute__((weak)) void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_OC_MspInit(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_OnePulse_MspInit(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+    __attribute__((weak)) void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim){ UNUSED(htim); }
+
+    HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim){
+        if(htim->State == HAL_TIM_STATE_RESET)
+            HAL_TIM_Base_MspInit(htim);
+        TimBaseConfig(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim){
+        __HAL_TIM_ENABLE(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim){
+        __HAL_TIM_DISABLE(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim){
+        __HAL_TIM_ENABLE_IT(htim, TIM_IT_UPDATE);
+        __HAL_TIM_ENABLE(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim){
+        __HAL_TIM_DISABLE_IT(htim, TIM_IT_UPDATE);
+        __HAL_TIM_DISABLE(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef *htim){
+        if(htim->State == HAL_TIM_STATE_RESET)
+            HAL_TIM_OC_MspInit(htim);
+        TimBaseConfig(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, const TIM_OC_InitTypeDef *sConfig,
+                                               uint32_t Channel){
+        TimOCConfig(htim, sConfig, Channel, false);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OC_Start(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStart(htim, Channel, false);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OC_Stop(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStop(htim, Channel, false);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStart(htim, Channel, true);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStop(htim, Channel, true);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim){
+        if(htim->State == HAL_TIM_STATE_RESET)
+            HAL_TIM_PWM_MspInit(htim);
+        TimBaseConfig(htim);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, const TIM_OC_InitTypeDef *sConfig,
+                                                uint32_t Channel){
+        TimOCConfig(htim, sConfig, Channel, true);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStart(htim, Channel, false);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStop(htim, Channel, false);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_PWM_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStart(htim, Channel, true);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_PWM_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel){
+        return TimChannelStop(htim, Channel, true);
+    }
+
+    HAL_StatusTypeDef HAL_TIM_OnePulse_Init(TIM_HandleTypeDef *htim, uint32_t OnePulseMode){
+        if(htim->State == HAL_TIM_STATE_RESET)
+            HAL_TIM_OnePulse_MspInit(htim);
+        TimBaseConfig(htim);
+        MODIFY_REG(htim->Instance->CR1, TIM_CR1_OPM, OnePulseMode);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, const TIM_ClockConfigTypeDef *sClockSourceConfig){
+        UNUSED(htim);
+        return sClockSourceConfig->ClockSource == TIM_CLOCKSOURCE_INTERNAL ? HAL_OK : HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim,
+                                                            const TIM_MasterConfigTypeDef *sMasterConfig){
+        UNUSED(htim);
+        UNUSED(sMasterConfig);
+        return HAL_OK;
+    }
+
+    void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim){
+        static constexpr HAL_TIM_ActiveChannel kActive[] = {
+            HAL_TIM_ACTIVE_CHANNEL_1, HAL_TIM_ACTIVE_CHANNEL_2,
+            HAL_TIM_ACTIVE_CHANNEL_3, HAL_TIM_ACTIVE_CHANNEL_4,
+        };
+        for(uint32_t ch = 0; ch < 4; ch++){
+            auto flag = TIM_SR_CC1IF << ch;
+            if(!__HAL_TIM_GET_FLAG(htim, flag) || !__HAL_TIM_GET_IT_SOURCE(htim, TIM_DIER_CC1IE << ch))
+                continue;
+            __HAL_TIM_CLEAR_IT(htim, flag);
+            htim->Channel = kActive[ch];
+            HAL_TIM_OC_DelayElapsedCallback(htim);
+            HAL_TIM_PWM_PulseFinishedCallback(htim);
+            htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+        }
+        if(__HAL_TIM_GET_FLAG(htim, TIM_FLAG_UPDATE) && __HAL_TIM_GET_IT_SOURCE(htim, TIM_IT_UPDATE)){
+            __HAL_TIM_CLEAR_IT(htim, TIM_IT_UPDATE);
+            HAL_TIM_PeriodElapsedCallback(htim);
+        }
+    }
+
+    // ------------------------------------------------------------------------------ IWDG --
+
+    HAL_StatusTypeDef HAL_IWDG_Init(IWDG_HandleTypeDef *hiwdg){
+        hiwdg->Instance->PR = hiwdg->Init.Prescaler;
+        hiwdg->Instance->RLR = hiwdg->Init.Reload;
+        hiwdg->Instance->WINR = hiwdg->Init.Window;
+        Machine::Get().StartWatchdog(hiwdg->Init.Prescaler, hiwdg->Init.Reload);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef *hiwdg){
+        UNUSED(hiwdg);
+        Machine::Get().RefreshWatchdog();
+        return HAL_OK;
+    }
+
+    // ----------------------------------------------------------------------------- FDCAN --
+
+    __attribute__((weak)) void HAL_FDCAN_MspInit(FDCAN_HandleTypeDef *hfdcan){ UNUSED(hfdcan); }
+
+    HAL_StatusTypeDef HAL_FDCAN_Init(FDCAN_HandleTypeDef *hfdcan){
+        if(hfdcan->State == HAL_FDCAN_STATE_RESET)
+            HAL_FDCAN_MspInit(hfdcan);
+        hfdcan->State = HAL_FDCAN_STATE_READY;
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_FDCAN_ConfigGlobalFilter(FDCAN_HandleTypeDef *hfdcan, uint32_t NonMatchingStd,
+                                                   uint32_t NonMatchingExt, uint32_t RejectRemoteStd,
+                                                   uint32_t RejectRemoteExt){
+        UNUSED(NonMatchingStd);
+        UNUSED(NonMatchingExt);
+        UNUSED(RejectRemoteStd);
+        UNUSED(RejectRemoteExt);
+        return hfdcan->State == HAL_FDCAN_STATE_READY ? HAL_OK : HAL_ERROR;
+    }
+
+    // standard id filters into RX FIFO 0, the only ones the firmware sets up
+    HAL_StatusTypeDef HAL_FDCAN_ConfigFilter(FDCAN_HandleTypeDef *hfdcan, FDCAN_FilterTypeDef *sFilterConfig){
+        if(hfdcan->State != HAL_FDCAN_STATE_READY || sFilterConfig->IdType != FDCAN_STANDARD_ID
+           || sFilterConfig->FilterIndex >= hfdcan->Init.StdFiltersNbr)
+            return HAL_ERROR;
+        Machine::Get().SetCanFilter(*sFilterConfig);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_FDCAN_Start(FDCAN_HandleTypeDef *hfdcan){
+        if(hfdcan->State != HAL_FDCAN_STATE_READY)
+            return HAL_ERROR;
+        hfdcan->State = HAL_FDCAN_STATE_BUSY;
+        Machine::Get().StartCan(hfdcan->Init);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_FDCAN_Stop(FDCAN_HandleTypeDef *hfdcan){
+        if(hfdcan->State != HAL_FDCAN_STATE_BUSY)
+            return HAL_ERROR;
+        hfdcan->State = HAL_FDCAN_STATE_READY;
+        Machine::Get().StopCan();
+        return HAL_OK;
+    }
+
+    uint32_t HAL_FDCAN_GetTxFifoFreeLevel(FDCAN_HandleTypeDef *hfdcan){
+        UNUSED(hfdcan);
+        return Machine::Get().CanTxFreeLevel();
+    }
+
+    uint32_t HAL_FDCAN_GetRxFifoFillLevel(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo){
+        UNUSED(hfdcan);
+        return RxFifo == FDCAN_RX_FIFO0 ? Machine::Get().CanRxFillLevel() : 0;
+    }
+
+    HAL_StatusTypeDef HAL_FDCAN_GetRxMessage(FDCAN_HandleTypeDef *hfdcan, uint32_t RxLocation,
+                                             FDCAN_RxHeaderTypeDef *pRxHeader, uint8_t *pRxData){
+        if(hfdcan->State != HAL_FDCAN_STATE_BUSY || RxLocation != FDCAN_RX_FIFO0)
+            return HAL_ERROR;
+        return Machine::Get().GetCanRx(*pRxHeader, pRxData) ? HAL_OK : HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef HAL_FDCAN_AddMessageToTxFifoQ(FDCAN_HandleTypeDef *hfdcan,
+                                                    const FDCAN_TxHeaderTypeDef *pTxHeader,
+                                                    const uint8_t *pTxData){
+        if(hfdcan->State != HAL_FDCAN_STATE_BUSY)
+            return HAL_ERROR;
+        return Machine::Get().AddCanTx(*pTxHeader, pTxData) ? HAL_OK : HAL_ERROR;
+    }
+
+    // ----------------------------------------------------------------------------- FLASH --
+
+    HAL_StatusTypeDef HAL_FLASH_Unlock(void){
+        flash_locked = false;
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_FLASH_Lock(void){
+        flash_locked = true;
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data){
+        if(flash_locked || TypeProgram != FLASH_TYPEPROGRAM_DOUBLEWORD || (Address & 0x7U)
+           || Address < FLASH_BASE || Address + sizeof(uint64_t) > FLASH_BASE + FLASH_SIZE)
+            return HAL_ERROR;
+        auto target = reinterpret_cast<uint64_t*>(static_cast<uintptr_t>(Address));
+        // PROGERR on the chip, a double word is programmed once after erase
+        if(*target != UINT64_MAX)
+            return HAL_ERROR;
+        Machine::Get().Stall(kFlashProgramTime);
+        *target = Data;
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError){
+        *PageError = UINT32_MAX;
+        if(flash_locked || pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES)
+            return HAL_ERROR;
+        for(uint32_t page = pEraseInit->Page; page < pEraseInit->Page + pEraseInit->NbPages; page++){
+            if(page >= FLASH_SIZE / FLASH_PAGE_SIZE){
+                *PageError = page;
+                return HAL_ERROR;
+            }
+            Machine::Get().Stall(kFlashPageEraseTime);
+            std::memset(reinterpret_cast<void*>(FLASH_BASE + page * FLASH_PAGE_SIZE), 0xFF, FLASH_PAGE_SIZE);
+        }
+        return HAL_OK;
+    }
+}
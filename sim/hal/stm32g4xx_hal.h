@@ -0,0 +1,728 @@
+/**
+  ******************************************************************************
+  * @file    stm32g4xx_hal.h
+  * @brief   Host stand-in for the STM32G4 HAL, CMSIS device and core headers.
+  *          Only the part of the API used by Core/Src, app/ and Libs/ is
+  *          declared. Register blocks are plain memory owned by the simulator
+  *          (sim/machine.cpp), constants keep the values of the ST headers.
+  ******************************************************************************
+  */
+#ifndef __STM32G4xx_HAL_H
+#define __STM32G4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ---------------------------------------------------------------- common -- */
+
+#define __IO    volatile
+#define __I     volatile const
+#define __STATIC_INLINE static inline
+
+typedef enum
+{
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+  HAL_UNLOCKED = 0x00U,
+  HAL_LOCKED   = 0x01U
+} HAL_LockTypeDef;
+
+typedef enum { RESET = 0U, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0U, ENABLE = !DISABLE } FunctionalState;
+
+#define UNUSED(X)               (void)X
+#define SET_BIT(REG, BIT)       ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)     ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)      ((REG) & (BIT))
+#define CLEAR_REG(REG)          ((REG) = (0x0))
+#define WRITE_REG(REG, VAL)     ((REG) = (VAL))
+#define READ_REG(REG)           ((REG))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK)  WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+
+/* ------------------------------------------------------------ core, NVIC -- */
+
+typedef enum
+{
+  NonMaskableInt_IRQn         = -14,
+  HardFault_IRQn              = -13,
+  MemoryManagement_IRQn       = -12,
+  BusFault_IRQn               = -11,
+  UsageFault_IRQn             = -10,
+  SVCall_IRQn                 = -5,
+  DebugMonitor_IRQn           = -4,
+  PendSV_IRQn                 = -2,
+  SysTick_IRQn                = -1,
+  FDCAN1_IT0_IRQn             = 21,
+  FDCAN1_IT1_IRQn             = 22,
+  EXTI9_5_IRQn                = 23,
+  TIM1_BRK_TIM15_IRQn         = 24,
+  TIM1_UP_TIM16_IRQn          = 25,
+  TIM1_TRG_COM_TIM17_IRQn     = 26,
+  TIM1_CC_IRQn                = 27,
+  TIM2_IRQn                   = 28,
+  TIM3_IRQn                   = 29,
+  TIM4_IRQn                   = 30,
+  EXTI15_10_IRQn              = 40,
+  TIM6_DAC_IRQn               = 54,
+  TIM7_IRQn                   = 55,
+  SIM_IRQn_COUNT              = 102
+} IRQn_Type;
+
+#define __NVIC_PRIO_BITS          4U
+
+#define NVIC_PRIORITYGROUP_0      0x00000007U
+#define NVIC_PRIORITYGROUP_1      0x00000006U
+#define NVIC_PRIORITYGROUP_2      0x00000005U
+#define NVIC_PRIORITYGROUP_3      0x00000004U
+#define NVIC_PRIORITYGROUP_4      0x00000003U
+
+void     NVIC_SetPriorityGrouping(uint32_t PriorityGroup);
+uint32_t NVIC_GetPriorityGrouping(void);
+uint32_t NVIC_EncodePriority(uint32_t PriorityGroup, uint32_t PreemptPriority, uint32_t SubPriority);
+void     NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type IRQn);
+void     NVIC_EnableIRQ(IRQn_Type IRQn);
+void     NVIC_DisableIRQ(IRQn_Type IRQn);
+void     NVIC_SetPendingIRQ(IRQn_Type IRQn);
+
+void     HAL_NVIC_SetPriorityGrouping(uint32_t PriorityGroup);
+void     HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void     HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void     HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* PRIMASK only defers dispatch, handlers never preempt code in the simulator */
+void     __disable_irq(void);
+void     __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t priMask);
+
+#define __NOP()   ((void)0)
+#define __DSB()   ((void)0)
+#define __ISB()   ((void)0)
+#define __DMB()   ((void)0)
+#define __WFI()   ((void)0)
+
+typedef struct
+{
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  __IO uint32_t DHCSR;
+  __IO uint32_t DCRSR;
+  __IO uint32_t DCRDR;
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk        (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk    (1UL << 24)
+
+extern DWT_Type sim_DWT;
+extern CoreDebug_Type sim_CoreDebug;
+#define DWT         (&sim_DWT)
+#define CoreDebug   (&sim_CoreDebug)
+
+extern uint32_t SystemCoreClock;
+
+/* ------------------------------------------------------------------ GPIO -- */
+
+typedef struct
+{
+  __IO uint32_t MODER;
+  __IO uint32_t OTYPER;
+  __IO uint32_t OSPEEDR;
+  __IO uint32_t PUPDR;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+  __IO uint32_t BSRR;
+  __IO uint32_t LCKR;
+  __IO uint32_t AFR[2];
+  __IO uint32_t BRR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef sim_GPIOA;
+extern GPIO_TypeDef sim_GPIOB;
+extern GPIO_TypeDef sim_GPIOF;
+#define GPIOA   (&sim_GPIOA)
+#define GPIOB   (&sim_GPIOB)
+#define GPIOF   (&sim_GPIOF)
+
+typedef struct
+{
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0U,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_0                 ((uint16_t)0x0001)
+#define GPIO_PIN_1                 ((uint16_t)0x0002)
+#define GPIO_PIN_2                 ((uint16_t)0x0004)
+#define GPIO_PIN_3                 ((uint16_t)0x0008)
+#define GPIO_PIN_4                 ((uint16_t)0x0010)
+#define GPIO_PIN_5                 ((uint16_t)0x0020)
+#define GPIO_PIN_6                 ((uint16_t)0x0040)
+#define GPIO_PIN_7                 ((uint16_t)0x0080)
+#define GPIO_PIN_8                 ((uint16_t)0x0100)
+#define GPIO_PIN_9                 ((uint16_t)0x0200)
+#define GPIO_PIN_10                ((uint16_t)0x0400)
+#define GPIO_PIN_11                ((uint16_t)0x0800)
+#define GPIO_PIN_12                ((uint16_t)0x1000)
+#define GPIO_PIN_13                ((uint16_t)0x2000)
+#define GPIO_PIN_14                ((uint16_t)0x4000)
+#define GPIO_PIN_15                ((uint16_t)0x8000)
+#define GPIO_PIN_All               ((uint16_t)0xFFFF)
+
+#define GPIO_MODE_INPUT            0x00000000U
+#define GPIO_MODE_OUTPUT_PP        0x00000001U
+#define GPIO_MODE_OUTPUT_OD        0x00000011U
+#define GPIO_MODE_AF_PP            0x00000002U
+#define GPIO_MODE_AF_OD            0x00000012U
+#define GPIO_MODE_ANALOG           0x00000003U
+
+#define GPIO_NOPULL                0x00000000U
+#define GPIO_PULLUP                0x00000001U
+#define GPIO_PULLDOWN              0x00000002U
+
+#define GPIO_SPEED_FREQ_LOW        0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM     0x00000001U
+#define GPIO_SPEED_FREQ_HIGH       0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH  0x00000003U
+
+#define GPIO_AF1_TIM2              ((uint8_t)0x01)
+#define GPIO_AF2_TIM4              ((uint8_t)0x02)
+#define GPIO_AF9_FDCAN1            ((uint8_t)0x09)
+
+void          HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void          HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void          HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void          HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* ------------------------------------------------------------------- TIM -- */
+
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t SMCR;
+  __IO uint32_t DIER;
+  __IO uint32_t SR;
+  __IO uint32_t EGR;
+  __IO uint32_t CCMR1;
+  __IO uint32_t CCMR2;
+  __IO uint32_t CCER;
+  __IO uint32_t CNT;
+  __IO uint32_t PSC;
+  __IO uint32_t ARR;
+  __IO uint32_t RCR;
+  __IO uint32_t CCR1;
+  __IO uint32_t CCR2;
+  __IO uint32_t CCR3;
+  __IO uint32_t CCR4;
+  __IO uint32_t BDTR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef sim_TIM1;
+extern TIM_TypeDef sim_TIM2;
+extern TIM_TypeDef sim_TIM3;
+extern TIM_TypeDef sim_TIM4;
+extern TIM_TypeDef sim_TIM6;
+extern TIM_TypeDef sim_TIM7;
+#define TIM1    (&sim_TIM1)
+#define TIM2    (&sim_TIM2)
+#define TIM3    (&sim_TIM3)
+#define TIM4    (&sim_TIM4)
+#define TIM6    (&sim_TIM6)
+#define TIM7    (&sim_TIM7)
+
+#define TIM_CR1_CEN           (0x1UL << 0)
+#define TIM_CR1_UDIS          (0x1UL << 1)
+#define TIM_CR1_URS           (0x1UL << 2)
+#define TIM_CR1_OPM           (0x1UL << 3)
+#define TIM_CR1_ARPE          (0x1UL << 7)
+#define TIM_DIER_UIE          (0x1UL << 0)
+#define TIM_DIER_CC1IE        (0x1UL << 1)
+#define TIM_DIER_CC2IE        (0x1UL << 2)
+#define TIM_DIER_CC3IE        (0x1UL << 3)
+#define TIM_DIER_CC4IE        (0x1UL << 4)
+#define TIM_SR_UIF            (0x1UL << 0)
+#define TIM_SR_CC1IF          (0x1UL << 1)
+#define TIM_SR_CC2IF          (0x1UL << 2)
+#define TIM_SR_CC3IF          (0x1UL << 3)
+#define TIM_SR_CC4IF          (0x1UL << 4)
+#define TIM_EGR_UG            (0x1UL << 0)
+#define TIM_CCMR1_CC1S        (0x3UL << 0)
+#define TIM_CCMR1_OC1FE       (0x1UL << 2)
+#define TIM_CCMR1_OC1PE       (0x1UL << 3)
+#define TIM_CCMR1_OC1M        (0x00010070UL)
+#define TIM_CCMR1_CC2S        (0x3UL << 8)
+#define TIM_CCMR1_OC2FE       (0x1UL << 10)
+#define TIM_CCMR1_OC2PE       (0x1UL << 11)
+#define TIM_CCMR1_OC2M        (0x01007000UL)
+#define TIM_CCER_CC1E         (0x1UL << 0)
+#define TIM_CCER_CC1P         (0x1UL << 1)
+#define TIM_BDTR_MOE          (0x1UL << 15)
+
+#define TIM_CHANNEL_1                     0x00000000U
+#define TIM_CHANNEL_2                     0x00000004U
+#define TIM_CHANNEL_3                     0x00000008U
+#define TIM_CHANNEL_4                     0x0000000CU
+#define TIM_CHANNEL_ALL                   0x0000003CU
+
+#define TIM_IT_UPDATE                     TIM_DIER_UIE
+#define TIM_IT_CC1                        TIM_DIER_CC1IE
+#define TIM_IT_CC2                        TIM_DIER_CC2IE
+#define TIM_IT_CC3                        TIM_DIER_CC3IE
+#define TIM_IT_CC4                        TIM_DIER_CC4IE
+#define TIM_FLAG_UPDATE                   TIM_SR_UIF
+#define TIM_FLAG_CC1                      TIM_SR_CC1IF
+#define TIM_FLAG_CC2                      TIM_SR_CC2IF
+#define TIM_FLAG_CC3                      TIM_SR_CC3IF
+#define TIM_FLAG_CC4                      TIM_SR_CC4IF
+#define TIM_EVENTSOURCE_UPDATE            TIM_EGR_UG
+
+#define TIM_OCMODE_TIMING                 0x00000000U
+#define TIM_OCMODE_ACTIVE                 0x00000010U
+#define TIM_OCMODE_INACTIVE               0x00000020U
+#define TIM_OCMODE_TOGGLE                 0x00000030U
+#define TIM_OCMODE_FORCED_INACTIVE        0x00000040U
+#define TIM_OCMODE_FORCED_ACTIVE          0x00000050U
+#define TIM_OCMODE_PWM1                   0x00000060U
+#define TIM_OCMODE_PWM2                   0x00000070U
+#define TIM_OCPOLARITY_HIGH               0x00000000U
+#define TIM_OCPOLARITY_LOW                TIM_CCER_CC1P
+#define TIM_OCFAST_DISABLE                0x00000000U
+#define TIM_OCFAST_ENABLE                 TIM_CCMR1_OC1FE
+
+#define TIM_COUNTERMODE_UP                0x00000000U
+#define TIM_CLOCKDIVISION_DIV1            0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE    0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE     TIM_CR1_ARPE
+#define TIM_OPMODE_SINGLE                 TIM_CR1_OPM
+#define TIM_OPMODE_REPETITIVE             0x00000000U
+#define TIM_CLOCKSOURCE_INTERNAL          0x00001000U
+#define TIM_TRGO_RESET                    0x00000000U
+#define TIM_TRGO2_RESET                   0x00000000U
+#define TIM_MASTERSLAVEMODE_DISABLE       0x00000000U
+
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t CounterMode;
+  uint32_t Period;
+  uint32_t ClockDivision;
+  uint32_t RepetitionCounter;
+  uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+  uint32_t OCMode;
+  uint32_t Pulse;
+  uint32_t OCPolarity;
+  uint32_t OCNPolarity;
+  uint32_t OCFastMode;
+  uint32_t OCIdleState;
+  uint32_t OCNIdleState;
+} TIM_OC_InitTypeDef;
+
+typedef struct
+{
+  uint32_t ClockSource;
+  uint32_t ClockPolarity;
+  uint32_t ClockPrescaler;
+  uint32_t ClockFilter;
+} TIM_ClockConfigTypeDef;
+
+typedef struct
+{
+  uint32_t MasterOutputTrigger;
+  uint32_t MasterOutputTrigger2;
+  uint32_t MasterSlaveMode;
+} TIM_MasterConfigTypeDef;
+
+typedef enum
+{
+  HAL_TIM_STATE_RESET   = 0x00U,
+  HAL_TIM_STATE_READY   = 0x01U,
+  HAL_TIM_STATE_BUSY    = 0x02U
+} HAL_TIM_StateTypeDef;
+
+typedef enum
+{
+  HAL_TIM_ACTIVE_CHANNEL_1        = 0x01U,
+  HAL_TIM_ACTIVE_CHANNEL_2        = 0x02U,
+  HAL_TIM_ACTIVE_CHANNEL_3        = 0x04U,
+  HAL_TIM_ACTIVE_CHANNEL_4        = 0x08U,
+  HAL_TIM_ACTIVE_CHANNEL_CLEARED  = 0x00U
+} HAL_TIM_ActiveChannel;
+
+typedef struct __TIM_HandleTypeDef
+{
+  TIM_TypeDef                 *Instance;
+  TIM_Base_InitTypeDef        Init;
+  HAL_TIM_ActiveChannel       Channel;
+  HAL_LockTypeDef             Lock;
+  __IO HAL_TIM_StateTypeDef   State;
+} TIM_HandleTypeDef;
+
+#define __HAL_TIM_ENABLE(__HANDLE__)                 ((__HANDLE__)->Instance->CR1 |= (TIM_CR1_CEN))
+#define __HAL_TIM_DISABLE(__HANDLE__) \
+  do { \
+    if (((__HANDLE__)->Instance->CCER & 0x1111U) == 0UL) \
+    { \
+      (__HANDLE__)->Instance->CR1 &= ~(TIM_CR1_CEN); \
+    } \
+  } while(0)
+#define __HAL_TIM_ENABLE_IT(__HANDLE__, __INTERRUPT__)    ((__HANDLE__)->Instance->DIER |= (__INTERRUPT__))
+#define __HAL_TIM_DISABLE_IT(__HANDLE__, __INTERRUPT__)   ((__HANDLE__)->Instance->DIER &= ~(__INTERRUPT__))
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__)          (((__HANDLE__)->Instance->SR &(__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_GET_IT_SOURCE(__HANDLE__, __INTERRUPT__) \
+  ((((__HANDLE__)->Instance->DIER & (__INTERRUPT__)) == (__INTERRUPT__)) ? SET : RESET)
+/* SR is rc_w0 on the chip, plain memory here */
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__)        ((__HANDLE__)->Instance->SR &= ~(__FLAG__))
+#define __HAL_TIM_CLEAR_IT(__HANDLE__, __INTERRUPT__)     ((__HANDLE__)->Instance->SR &= ~(__INTERRUPT__))
+#define __HAL_TIM_GENERATE_EVENT(__HANDLE__, __EVENT__)   ((__HANDLE__)->Instance->EGR = (__EVENT__))
+#define __HAL_TIM_URS_ENABLE(__HANDLE__)                  ((__HANDLE__)->Instance->CR1 |= TIM_CR1_URS)
+#define __HAL_TIM_URS_DISABLE(__HANDLE__)                 ((__HANDLE__)->Instance->CR1 &= ~TIM_CR1_URS)
+#define __HAL_TIM_SET_PRESCALER(__HANDLE__, __PRESC__)    ((__HANDLE__)->Instance->PSC = (__PRESC__))
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__)    ((__HANDLE__)->Instance->CNT = (__COUNTER__))
+#define __HAL_TIM_GET_COUNTER(__HANDLE__)                 ((__HANDLE__)->Instance->CNT)
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__) \
+  do { \
+    (__HANDLE__)->Instance->ARR = (__AUTORELOAD__); \
+    (__HANDLE__)->Init.Period = (__AUTORELOAD__); \
+  } while(0)
+#define __HAL_TIM_GET_AUTORELOAD(__HANDLE__)              ((__HANDLE__)->Instance->ARR)
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) \
+  (*(&(__HANDLE__)->Instance->CCR1 + ((__CHANNEL__) >> 2U)) = (__COMPARE__))
+#define __HAL_TIM_GET_COMPARE(__HANDLE__, __CHANNEL__) \
+  (*(&(__HANDLE__)->Instance->CCR1 + ((__CHANNEL__) >> 2U)))
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, const TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, const TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OnePulse_Init(TIM_HandleTypeDef *htim, uint32_t OnePulseMode);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, const TIM_ClockConfigTypeDef *sClockSourceConfig);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, const TIM_MasterConfigTypeDef *sMasterConfig);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_OC_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_OnePulse_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim);
+
+/* --------------------------------------------------------------- DBGMCU -- */
+
+#define __HAL_DBGMCU_FREEZE_TIM1()    ((void)0)
+#define __HAL_DBGMCU_FREEZE_TIM2()    ((void)0)
+#define __HAL_DBGMCU_FREEZE_TIM4()    ((void)0)
+
+/* -------------------------------------------------------------- RCC, PWR -- */
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_GPIOF_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_TIM1_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM2_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM3_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM4_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM6_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM7_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM1_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_TIM2_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_TIM3_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_TIM4_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_TIM6_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_TIM7_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_FDCAN_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_FDCAN_CLK_DISABLE()   ((void)0)
+#define __HAL_RCC_PWR_CLK_ENABLE()      ((void)0)
+#define __HAL_RCC_RTCAPB_CLK_ENABLE()   ((void)0)
+#define __HAL_RCC_SYSCFG_CLK_ENABLE()   ((void)0)
+
+void HAL_PWR_EnableBkUpAccess(void);
+
+/* ------------------------------------------------------------------ TAMP -- */
+
+typedef struct
+{
+  __IO uint32_t BKP0R;
+  __IO uint32_t BKP1R;
+  __IO uint32_t BKP2R;
+  __IO uint32_t BKP3R;
+  __IO uint32_t BKP4R;
+  __IO uint32_t BKP5R;
+  __IO uint32_t BKP6R;
+  __IO uint32_t BKP7R;
+  __IO uint32_t BKP8R;
+  __IO uint32_t BKP9R;
+  __IO uint32_t BKP10R;
+  __IO uint32_t BKP11R;
+  __IO uint32_t BKP12R;
+  __IO uint32_t BKP13R;
+  __IO uint32_t BKP14R;
+  __IO uint32_t BKP15R;
+} TAMP_TypeDef;
+
+extern TAMP_TypeDef sim_TAMP;
+#define TAMP    (&sim_TAMP)
+
+/* ------------------------------------------------------------------ IWDG -- */
+
+typedef struct
+{
+  __IO uint32_t KR;
+  __IO uint32_t PR;
+  __IO uint32_t RLR;
+  __IO uint32_t SR;
+  __IO uint32_t WINR;
+} IWDG_TypeDef;
+
+extern IWDG_TypeDef sim_IWDG;
+#define IWDG    (&sim_IWDG)
+
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t Reload;
+  uint32_t Window;
+} IWDG_InitTypeDef;
+
+typedef struct
+{
+  IWDG_TypeDef      *Instance;
+  IWDG_InitTypeDef  Init;
+} IWDG_HandleTypeDef;
+
+#define IWDG_PRESCALER_4      0x00000000U
+#define IWDG_PRESCALER_8      0x00000001U
+#define IWDG_PRESCALER_16     0x00000002U
+#define IWDG_PRESCALER_32     0x00000003U
+#define IWDG_PRESCALER_64     0x00000004U
+#define IWDG_PRESCALER_128    0x00000005U
+#define IWDG_PRESCALER_256    0x00000006U
+#define IWDG_WINDOW_DISABLE   0x00000FFFU
+
+HAL_StatusTypeDef HAL_IWDG_Init(IWDG_HandleTypeDef *hiwdg);
+HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef *hiwdg);
+
+/* ----------------------------------------------------------------- FDCAN -- */
+
+typedef struct
+{
+  __IO uint32_t CCCR;
+  __IO uint32_t TXFQS;
+} FDCAN_GlobalTypeDef;
+
+extern FDCAN_GlobalTypeDef sim_FDCAN1;
+#define FDCAN1  (&sim_FDCAN1)
+
+typedef struct
+{
+  uint32_t ClockDivider;
+  uint32_t FrameFormat;
+  uint32_t Mode;
+  FunctionalState AutoRetransmission;
+  FunctionalState TransmitPause;
+  FunctionalState ProtocolException;
+  uint32_t NominalPrescaler;
+  uint32_t NominalSyncJumpWidth;
+  uint32_t NominalTimeSeg1;
+  uint32_t NominalTimeSeg2;
+  uint32_t DataPrescaler;
+  uint32_t DataSyncJumpWidth;
+  uint32_t DataTimeSeg1;
+  uint32_t DataTimeSeg2;
+  uint32_t StdFiltersNbr;
+  uint32_t ExtFiltersNbr;
+  uint32_t TxFifoQueueMode;
+} FDCAN_InitTypeDef;
+
+typedef enum
+{
+  HAL_FDCAN_STATE_RESET   = 0x00U,
+  HAL_FDCAN_STATE_READY   = 0x01U,
+  HAL_FDCAN_STATE_BUSY    = 0x02U
+} HAL_FDCAN_StateTypeDef;
+
+typedef struct
+{
+  FDCAN_GlobalTypeDef           *Instance;
+  FDCAN_InitTypeDef             Init;
+  __IO HAL_FDCAN_StateTypeDef   State;
+  __IO uint32_t                 ErrorCode;
+} FDCAN_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t Identifier;
+  uint32_t IdType;
+  uint32_t TxFrameType;
+  uint32_t DataLength;
+  uint32_t ErrorStateIndicator;
+  uint32_t BitRateSwitch;
+  uint32_t FDFormat;
+  uint32_t TxEventFifoControl;
+  uint32_t MessageMarker;
+} FDCAN_TxHeaderTypeDef;
+
+typedef struct
+{
+  uint32_t Identifier;
+  uint32_t IdType;
+  uint32_t RxFrameType;
+  uint32_t DataLength;
+  uint32_t ErrorStateIndicator;
+  uint32_t BitRateSwitch;
+  uint32_t FDFormat;
+  uint32_t RxTimestamp;
+  uint32_t FilterIndex;
+  uint32_t IsFilterMatchingFrame;
+} FDCAN_RxHeaderTypeDef;
+
+typedef struct
+{
+  uint32_t IdType;
+  uint32_t FilterIndex;
+  uint32_t FilterType;
+  uint32_t FilterConfig;
+  uint32_t FilterID1;
+  uint32_t FilterID2;
+} FDCAN_FilterTypeDef;
+
+#define FDCAN_CLOCK_DIV1            0x00000000U
+#define FDCAN_FRAME_CLASSIC         0x00000000U
+#define FDCAN_MODE_NORMAL           0x00000000U
+#define FDCAN_TX_FIFO_OPERATION     0x00000000U
+#define FDCAN_STANDARD_ID           0x00000000U
+#define FDCAN_EXTENDED_ID           0x40000000U
+#define FDCAN_DATA_FRAME            0x00000000U
+#define FDCAN_REMOTE_FRAME          0x20000000U
+#define FDCAN_DLC_BYTES_0           0x00000000U
+#define FDCAN_DLC_BYTES_1           0x00010000U
+#define FDCAN_DLC_BYTES_2           0x00020000U
+#define FDCAN_DLC_BYTES_3           0x00030000U
+#define FDCAN_DLC_BYTES_4           0x00040000U
+#define FDCAN_DLC_BYTES_5           0x00050000U
+#define FDCAN_DLC_BYTES_6           0x00060000U
+#define FDCAN_DLC_BYTES_7           0x00070000U
+#define FDCAN_DLC_BYTES_8           0x00080000U
+#define FDCAN_ESI_ACTIVE            0x00000000U
+#define FDCAN_BRS_OFF               0x00000000U
+#define FDCAN_CLASSIC_CAN           0x00000000U
+#define FDCAN_NO_TX_EVENTS          0x00000000U
+#define FDCAN_ACCEPT_IN_RX_FIFO0    0x00000000U
+#define FDCAN_ACCEPT_IN_RX_FIFO1    0x00000001U
+#define FDCAN_REJECT                0x00000002U
+#define FDCAN_FILTER_REMOTE         0x00000000U
+#define FDCAN_REJECT_REMOTE         0x00000001U
+#define FDCAN_FILTER_RANGE          0x00000000U
+#define FDCAN_FILTER_DUAL           0x00000001U
+#define FDCAN_FILTER_MASK           0x00000002U
+#define FDCAN_FILTER_DISABLE        0x00000000U
+#define FDCAN_FILTER_TO_RXFIFO0     0x00000001U
+#define FDCAN_FILTER_TO_RXFIFO1     0x00000002U
+#define FDCAN_FILTER_REJECT         0x00000003U
+#define FDCAN_RX_FIFO0              0x00000040U
+#define FDCAN_RX_FIFO1              0x00000041U
+
+HAL_StatusTypeDef HAL_FDCAN_Init(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_ConfigGlobalFilter(FDCAN_HandleTypeDef *hfdcan, uint32_t NonMatchingStd,
+                                               uint32_t NonMatchingExt, uint32_t RejectRemoteStd,
+                                               uint32_t RejectRemoteExt);
+HAL_StatusTypeDef HAL_FDCAN_ConfigFilter(FDCAN_HandleTypeDef *hfdcan, FDCAN_FilterTypeDef *sFilterConfig);
+HAL_StatusTypeDef HAL_FDCAN_Start(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_Stop(FDCAN_HandleTypeDef *hfdcan);
+uint32_t HAL_FDCAN_GetTxFifoFreeLevel(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_AddMessageToTxFifoQ(FDCAN_HandleTypeDef *hfdcan, const FDCAN_TxHeaderTypeDef *pTxHeader,
+                                                const uint8_t *pTxData);
+uint32_t HAL_FDCAN_GetRxFifoFillLevel(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo);
+HAL_StatusTypeDef HAL_FDCAN_GetRxMessage(FDCAN_HandleTypeDef *hfdcan, uint32_t RxLocation,
+                                         FDCAN_RxHeaderTypeDef *pRxHeader, uint8_t *pRxData);
+void HAL_FDCAN_MspInit(FDCAN_HandleTypeDef *hfdcan);
+
+/* ----------------------------------------------------------------- FLASH -- */
+
+#define FLASH_BASE                    0x08000000U    /* U, unsigned long is 64-bit on the host */
+#define FLASH_SIZE                    0x00020000U
+#define FLASH_PAGE_SIZE               0x00000800U
+#define FLASH_BANK_1                  0x00000001U
+#define FLASH_TYPEERASE_PAGES         0x00U
+#define FLASH_TYPEPROGRAM_DOUBLEWORD  0x00U
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Page;
+  uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+
+/* ------------------------------------------------------------------ core -- */
+
+typedef enum
+{
+  HAL_TICK_FREQ_1KHZ    = 1U,
+  HAL_TICK_FREQ_DEFAULT = HAL_TICK_FREQ_1KHZ
+} HAL_TickFreqTypeDef;
+
+#define TICK_INT_PRIORITY   (0UL)
+
+extern __IO uint32_t uwTick;
+extern uint32_t uwTickPrio;
+extern HAL_TickFreqTypeDef uwTickFreq;
+
+HAL_StatusTypeDef HAL_Init(void);
+void     HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void     HAL_Delay(uint32_t Delay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32G4xx_HAL_H */
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "event_queue.hpp"
+
+namespace sim{
+
+// InputLog dumps (CanTelemetry::Msg::input_log frames) read back from a CAN log, either
+// candump ("603#..." or "603 [8] .."), or RasterDriverSim output ("can 0x603 .."). Frames
+// of one dump are ordered by their sequence number and become GPIOA input changes.
+class InputReplay{
+public:
+    // TELEMETRY_CAN_ID + CanTelemetry::Msg::input_log, app_config.hpp is private to app.cpp
+    static constexpr uint32_t kCanId = 0x603;
+    // InputLog::kShift, the logged inputs are PA6..PA9
+    static constexpr uint8_t kShift = 6;
+    static constexpr uint16_t kMask = 0xF << kShift;
+
+    struct Change{
+        Nanos at;
+        uint16_t levels;    // GPIOA bits within kMask
+        uint16_t changed;
+    };
+
+    // start: time of the first entry, by default the MotionClock time it was logged at
+    bool Load(const char* path, std::optional<Nanos> start){
+        auto file = std::fopen(path, "r");
+        if(!file)
+            return false;
+        std::vector<Entry> entries;
+        char line[256];
+        while(std::fgets(line, sizeof(line), file)){
+            std::array<uint8_t, 8> data;
+            if(ParseFrame(line, data))
+                entries.push_back(Decode(data));
+        }
+        std::fclose(file);
+        if(entries.empty())
+            return false;
+
+        // sequence numbers are 16 bit, the dump is sent in order so unwrap against the first
+        auto first_seq = entries.front().seq;
+        for(auto& e : entries)
+            e.order = static_cast<uint16_t>(e.seq - first_seq);
+        std::stable_sort(entries.begin(), entries.end(), [](auto& a, auto& b){ return a.order < b.order; });
+        entries.erase(std::unique(entries.begin(), entries.end(), [](auto& a, auto& b){ return a.order == b.order; }),
+                      entries.end());
+        gaps_ = entries.back().order + 1u - static_cast<uint32_t>(entries.size());
+
+        initial_ = static_cast<uint16_t>((entries.front().levels ^ entries.front().changed) << kShift);
+        auto t0 = entries.front().time;
+        auto origin = start ? *start : static_cast<Nanos>(t0) * 1000;
+        changes_.clear();
+        for(auto& e : entries){
+            // MotionClock wraps, 32 bit differences stay right for dumps shorter than ~71 min
+            auto dt = static_cast<Nanos>(static_cast<uint32_t>(e.time - t0)) * 1000;
+            changes_.push_back({origin + dt, static_cast<uint16_t>(e.levels << kShift),
+                                static_cast<uint16_t>(e.changed << kShift)});
+        }
+        return true;
+    }
+
+    // levels before the first logged edge, applied at reset
+    [[nodiscard]] uint16_t Initial() const{ return initial_; }
+    [[nodiscard]] const std::vector<Change>& Changes() const{ return changes_; }
+    // entries missing from the dump, e.g. frames lost on the bus
+    [[nodiscard]] uint32_t Gaps() const{ return gaps_; }
+
+private:
+    struct Entry{
+        uint16_t seq;
+        uint16_t order;
+        uint8_t levels;
+        uint8_t changed;
+        uint32_t time;
+    };
+
+    static Entry Decode(const std::array<uint8_t, 8>& d){
+        return {static_cast<uint16_t>(d[0] | d[1] << 8), 0, static_cast<uint8_t>(d[2] & 0xF),
+                static_cast<uint8_t>(d[3] & 0xF),
+                d[4] | static_cast<uint32_t>(d[5]) << 8 | static_cast<uint32_t>(d[6]) << 16
+                     | static_cast<uint32_t>(d[7]) << 24};
+    }
+
+    static bool ParseFrame(const char* line, std::array<uint8_t, 8>& data){
+        std::vector<std::string_view> tokens;
+        for(const char* p = line; *p;){
+            while(*p && std::strchr(" \t\r\n", *p))
+                p++;
+            auto begin = p;
+            while(*p && !std::strchr(" \t\r\n", *p))
+                p++;
+            if(p != begin)
+                tokens.emplace_back(begin, static_cast<std::size_t>(p - begin));
+        }
+        for(std::size_t i = 0; i < tokens.size(); i++){
+            auto token = tokens[i];
+            // candump -l: 603#0000090908030000
+            if(auto hash = token.find('#'); hash != std::string_view::npos){
+                if(ParseId(token.substr(0, hash)) != kCanId || token.size() - hash - 1 != 16)
+                    continue;
+                for(std::size_t b = 0; b < data.size(); b++)
+                    data[b] = static_cast<uint8_t>(std::strtoul(std::string{token.substr(hash + 1 + 2 * b, 2)}.c_str(), nullptr, 16));
+                return true;
+            }
+            if(ParseId(token) != kCanId)
+                continue;
+            auto first = i + 1;
+            if(first < tokens.size() && tokens[first] == "[8]")
+                first++;
+            if(tokens.size() - first < data.size())
+                return false;
+            for(std::size_t b = 0; b < data.size(); b++)
+                data[b] = static_cast<uint8_t>(std::strtoul(std::string{tokens[first + b]}.c_str(), nullptr, 16));
+            return true;
+        }
+        return false;
+    }
+
+    static uint32_t ParseId(std::string_view token){
+        if(token.starts_with("0x") || token.starts_with("0X"))
+            token.remove_prefix(2);
+        if(token.empty() || token.size() > 3 || token.find_first_not_of("0123456789abcdefABCDEF") != std::string_view::npos)
+            return UINT32_MAX;
+        return static_cast<uint32_t>(std::strtoul(std::string{token}.c_str(), nullptr, 16));
+    }
+
+    uint16_t initial_ {0};
+    std::vector<Change> changes_;
+    uint32_t gaps_ {0};
+};
+
+}
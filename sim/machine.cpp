@@ -0,0 +1,552 @@
+#include "machine.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "stm32g4xx_it.h"
+
+DWT_Type sim_DWT;
+CoreDebug_Type sim_CoreDebug;
+GPIO_TypeDef sim_GPIOA;
+GPIO_TypeDef sim_GPIOB;
+GPIO_TypeDef sim_GPIOF;
+TIM_TypeDef sim_TIM1;
+TIM_TypeDef sim_TIM2;
+TIM_TypeDef sim_TIM3;
+TIM_TypeDef sim_TIM4;
+TIM_TypeDef sim_TIM6;
+TIM_TypeDef sim_TIM7;
+TAMP_TypeDef sim_TAMP;
+IWDG_TypeDef sim_IWDG;
+FDCAN_GlobalTypeDef sim_FDCAN1;
+
+namespace sim{
+
+namespace{
+    struct Vector{
+        IRQn_Type irq;
+        void (*handler)();
+    };
+
+    // handlers of Core/Src/stm32g4xx_it.c
+    constexpr std::array<Vector, 6> kVectors{{
+        {SysTick_IRQn, SysTick_Handler},
+        {TIM1_UP_TIM16_IRQn, TIM1_UP_TIM16_IRQHandler},
+        {TIM3_IRQn, TIM3_IRQHandler},
+        {TIM4_IRQn, TIM4_IRQHandler},
+        {TIM6_DAC_IRQn, TIM6_DAC_IRQHandler},
+        {TIM7_IRQn, TIM7_IRQHandler},
+    }};
+
+    // datasheet typical values
+    constexpr Cycles kClassicFrameOverheadBits = 47;
+}
+
+// ---------------------------------------------------------------------------------- Timer --
+
+void Timer::Sync(){
+    if(regs_->EGR & TIM_EGR_UG){
+        regs_->EGR = 0;
+        regs_->CNT = 0;
+        phase_ = 0;
+        LatchShadows();
+        if(!(regs_->CR1 & (TIM_CR1_URS | TIM_CR1_UDIS)))
+            regs_->SR |= TIM_SR_UIF;
+    }
+    if(!(regs_->CR1 & TIM_CR1_ARPE))
+        arr_ = regs_->ARR & counter_max_;
+    for(uint8_t ch = 0; ch < kChannels; ch++){
+        if(!IsPreloaded(ch))
+            ccr_[ch] = Ccr(ch) & counter_max_;
+    }
+}
+
+std::optional<Cycles> Timer::CyclesToNextEvent() const{
+    if(!(regs_->CR1 & TIM_CR1_CEN))
+        return std::nullopt;
+    auto cnt = regs_->CNT & counter_max_;
+    uint64_t ticks = TicksToUpdate();
+    for(uint8_t ch = 0; ch < kChannels; ch++){
+        if(!IsChannelUsed(ch) || ccr_[ch] > arr_)
+            continue;
+        uint64_t to_match = ccr_[ch] > cnt ? ccr_[ch] - cnt : TicksToUpdate() + ccr_[ch];
+        ticks = std::min(ticks, to_match);
+    }
+    return ticks * Divider() - phase_;
+}
+
+void Timer::Advance(Cycles cycles){
+    if(!(regs_->CR1 & TIM_CR1_CEN))
+        return;
+    auto total = phase_ + cycles;
+    uint64_t ticks = total / Divider();
+    phase_ = total % Divider();
+    if(!ticks)
+        return;
+    auto to_update = TicksToUpdate();
+    if(ticks >= to_update){
+        regs_->CNT = static_cast<uint32_t>(ticks - to_update);
+        UpdateEvent();
+    }else
+        regs_->CNT = static_cast<uint32_t>((regs_->CNT & counter_max_) + ticks);
+    for(uint8_t ch = 0; ch < kChannels; ch++){
+        if(IsChannelUsed(ch) && regs_->CNT == ccr_[ch])
+            CompareMatch(ch);
+    }
+}
+
+bool Timer::OutputLevel(uint8_t channel) const{
+    if(!(regs_->CCER & (TIM_CCER_CC1E << (channel * 4))))
+        return false;
+    bool ref;
+    switch(Mode(channel)){
+        case kForcedInactive:
+            ref = false;
+            break;
+        case kForcedActive:
+            ref = true;
+            break;
+        case kPwm1:
+            ref = (regs_->CNT & counter_max_) < ccr_[channel];
+            break;
+        case kPwm2:
+            ref = (regs_->CNT & counter_max_) >= ccr_[channel];
+            break;
+        default:
+            ref = ref_[channel];
+            break;
+    }
+    bool inverted = regs_->CCER & (TIM_CCER_CC1P << (channel * 4));
+    return ref != inverted;
+}
+
+bool Timer::IsIrqPending(IRQn_Type irq) const{
+    auto active = regs_->SR & regs_->DIER;
+    if(irq == update_irq_ && (active & TIM_SR_UIF))
+        return true;
+    return irq == cc_irq_ && (active & (TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC3IF | TIM_SR_CC4IF));
+}
+
+uint64_t Timer::TicksToUpdate() const{
+    auto cnt = regs_->CNT & counter_max_;
+    // a counter written above ARR runs up to its maximum and wraps
+    auto top = cnt <= arr_ ? arr_ : counter_max_;
+    return static_cast<uint64_t>(top) - cnt + 1;
+}
+
+bool Timer::IsChannelUsed(uint8_t channel) const{
+    return (regs_->CCER & (TIM_CCER_CC1E << (channel * 4)))
+        || (regs_->DIER & (TIM_DIER_CC1IE << channel));
+}
+
+Timer::OCMode Timer::Mode(uint8_t channel) const{
+    auto ccmr = channel < 2 ? regs_->CCMR1 : regs_->CCMR2;
+    auto shift = (channel % 2) * 8;
+    auto mode = ((ccmr >> (4 + shift)) & 0x7) | (((ccmr >> (16 + shift)) & 0x1) << 3);
+    return static_cast<OCMode>(mode & 0x7);
+}
+
+bool Timer::IsPreloaded(uint8_t channel) const{
+    auto ccmr = channel < 2 ? regs_->CCMR1 : regs_->CCMR2;
+    return ccmr & (TIM_CCMR1_OC1PE << ((channel % 2) * 8));
+}
+
+volatile uint32_t& Timer::Ccr(uint8_t channel) const{
+    return (&regs_->CCR1)[channel];
+}
+
+void Timer::UpdateEvent(){
+    if(regs_->CR1 & TIM_CR1_UDIS)
+        return;
+    regs_->SR |= TIM_SR_UIF;
+    LatchShadows();
+    if(regs_->CR1 & TIM_CR1_OPM)
+        regs_->CR1 &= ~TIM_CR1_CEN;
+}
+
+void Timer::CompareMatch(uint8_t channel){
+    regs_->SR |= TIM_SR_CC1IF << channel;
+    switch(Mode(channel)){
+        case kActive:
+            ref_[channel] = true;
+            break;
+        case kInactive:
+            ref_[channel] = false;
+            break;
+        case kToggle:
+            ref_[channel] = !ref_[channel];
+            break;
+        default:
+            break;
+    }
+}
+
+void Timer::LatchShadows(){
+    psc_ = regs_->PSC & 0xFFFF;
+    arr_ = regs_->ARR & counter_max_;
+    for(uint8_t ch = 0; ch < kChannels; ch++)
+        ccr_[ch] = Ccr(ch) & counter_max_;
+}
+
+// -------------------------------------------------------------------------------- Machine --
+
+Machine& Machine::Get(){
+    static Machine machine;
+    return machine;
+}
+
+Machine::Machine()
+    :timers_{{
+        {TIM1, 0xFFFF, TIM1_UP_TIM16_IRQn, TIM1_CC_IRQn},
+        {TIM2, 0xFFFFFFFF, TIM2_IRQn, TIM2_IRQn},
+        {TIM3, 0xFFFF, TIM3_IRQn, TIM3_IRQn},
+        {TIM4, 0xFFFF, TIM4_IRQn, TIM4_IRQn},
+        {TIM6, 0xFFFF, TIM6_DAC_IRQn, TIM6_DAC_IRQn},
+        {TIM7, 0xFFFF, TIM7_IRQn, TIM7_IRQn},
+    }}
+    ,ports_{{{GPIOA}, {GPIOB}, {GPIOF}}}
+    // pins bound to timer channels by the CubeMX configuration
+    ,alternate_outputs_{{
+        {GPIOA, GPIO_PIN_5, GPIO_AF1_TIM2, &timers_[1], 0},
+        {GPIOB, GPIO_PIN_7, GPIO_AF2_TIM4, &timers_[3], 1},
+    }}
+{
+    for(auto& timer : timers_)
+        timer.Regs()->ARR = 0xFFFF;
+    sim_TIM2.ARR = 0xFFFFFFFF;
+    // the exposure request is active low and idles high, no exposure is requested at reset
+    SetInput(EXP_REQ_IN_GPIO_Port, EXP_REQ_IN_Pin, true);
+}
+
+bool Machine::MapFlash(const char* image_path){
+    auto address = reinterpret_cast<void*>(FLASH_BASE);
+    void* flash;
+    if(image_path){
+        int fd = open(image_path, O_RDWR | O_CREAT, 0644);
+        if(fd < 0)
+            return false;
+        off_t size = lseek(fd, 0, SEEK_END);
+        if(size < static_cast<off_t>(FLASH_SIZE)){
+            std::array<uint8_t, FLASH_PAGE_SIZE> erased;
+            erased.fill(0xFF);
+            for(; size < static_cast<off_t>(FLASH_SIZE); size += FLASH_PAGE_SIZE)
+                (void)!write(fd, erased.data(), erased.size());
+        }
+        flash = mmap(address, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+        close(fd);
+    }else{
+        flash = mmap(address, FLASH_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if(flash == address)
+            std::memset(flash, 0xFF, FLASH_SIZE);
+    }
+    return flash == address;
+}
+
+void Machine::SetInput(GPIO_TypeDef* port, uint16_t pins, bool level){
+    for(auto& p : ports_){
+        if(p.regs != port)
+            continue;
+        if(level)
+            p.external |= pins;
+        else
+            p.external &= ~pins;
+    }
+    UpdatePins();
+}
+
+void Machine::ScheduleInput(Nanos at, GPIO_TypeDef* port, uint16_t pins, bool level){
+    queue_.Post(std::max(at, now_), static_cast<uint32_t>(inputs_.size()));
+    inputs_.push_back({port, pins, level});
+}
+
+void Machine::ScheduleWakeup(Nanos at){
+    queue_.Post(std::max(at, now_), kWakeup);
+}
+
+bool Machine::Step(Nanos limit){
+    if(halted_ || now_ >= limit)
+        return false;
+    SyncRegisters();
+    ScheduleTimers();
+    auto event = queue_.Pop(limit);
+    if(!event){
+        AdvanceTo(limit);
+        return false;
+    }
+    AdvanceTo(event->at);
+    // everything due at this time is handled before the first handler runs
+    do{
+        Handle(*event);
+        event = queue_.Pop(now_);
+    }while(event);
+    Dispatch();
+    return !halted_ && now_ < limit;
+}
+
+void Machine::Stall(Nanos duration){
+    auto end = now_ + duration;
+    while(!halted_){
+        SyncRegisters();
+        ScheduleTimers();
+        auto event = queue_.Pop(end);
+        if(!event)
+            break;
+        AdvanceTo(event->at);
+        Handle(*event);
+    }
+    AdvanceTo(end);
+    // interrupts raised meanwhile are taken as soon as the CPU is free again
+    queue_.Post(now_, kWakeup);
+}
+
+void Machine::SyncRegisters(){
+    for(auto& timer : timers_)
+        timer.Sync();
+    for(auto& port : ports_){
+        auto& regs = *port.regs;
+        regs.ODR = (regs.ODR | (regs.BSRR & 0xFFFF)) & ~(regs.BSRR >> 16) & ~regs.BRR;
+        regs.BSRR = 0;
+        regs.BRR = 0;
+    }
+    UpdatePins();
+}
+
+void Machine::StartSysTick(){
+    queue_.Schedule(kSysTick, now_ + kNanosPerMSec);
+}
+
+void Machine::StartWatchdog(uint32_t prescaler, uint32_t reload){
+    watchdog_running_ = true;
+    watchdog_timeout_ = static_cast<Nanos>(reload + 1) * (4u << prescaler) * (1'000'000'000 / kLsiHz);
+    RefreshWatchdog();
+}
+
+void Machine::RefreshWatchdog(){
+    if(watchdog_running_)
+        queue_.Schedule(kWatchdog, now_ + watchdog_timeout_ + 1);
+}
+
+void Machine::StartCan(const FDCAN_InitTypeDef& init){
+    can_started_ = true;
+    auto bit_cycles = static_cast<Cycles>(init.NominalPrescaler) * (1 + init.NominalTimeSeg1 + init.NominalTimeSeg2);
+    can_bit_time_ = std::max<Nanos>(1, NanosAt(bit_cycles));
+}
+
+uint32_t Machine::CanTxFreeLevel() const{
+    return kCanTxFifoSize - static_cast<uint32_t>(can_tx_.size());
+}
+
+bool Machine::AddCanTx(const FDCAN_TxHeaderTypeDef& header, const uint8_t* data){
+    if(!can_started_ || !CanTxFreeLevel())
+        return false;
+    auto len = std::min<uint32_t>(header.DataLength >> 16, 8);
+    auto start = can_tx_.empty() ? now_ : can_tx_.back().done;
+    CanFrame frame{start + (kClassicFrameOverheadBits + len * 8) * can_bit_time_, header, {}};
+    std::copy_n(data, len, frame.data.begin());
+    can_tx_.push_back(frame);
+    if(can_tx_.size() == 1)
+        queue_.Schedule(kCanTx, frame.done);
+    return true;
+}
+
+void Machine::SetCanFilter(const FDCAN_FilterTypeDef& filter){
+    if(can_filters_.size() <= filter.FilterIndex)
+        can_filters_.resize(filter.FilterIndex + 1, FDCAN_FilterTypeDef{FDCAN_STANDARD_ID, 0, FDCAN_FILTER_RANGE,
+                                                                           FDCAN_FILTER_DISABLE, 0, 0});
+    can_filters_[filter.FilterIndex] = filter;
+}
+
+void Machine::ScheduleCanRx(Nanos at, uint32_t id, const std::vector<uint8_t>& data){
+    auto len = static_cast<uint32_t>(std::min<std::size_t>(data.size(), 8));
+    CanRxFrame frame{std::max(at, now_), {}, {}};
+    frame.header.Identifier = id;
+    frame.header.IdType = FDCAN_STANDARD_ID;
+    frame.header.RxFrameType = FDCAN_DATA_FRAME;
+    frame.header.DataLength = len << 16;
+    std::copy_n(data.begin(), len, frame.data.begin());
+    auto pos = std::upper_bound(can_bus_rx_.begin(), can_bus_rx_.end(), frame.at,
+                                [](Nanos at, const CanRxFrame& other){ return at < other.at; });
+    can_bus_rx_.insert(pos, frame);
+    queue_.Schedule(kCanRx, can_bus_rx_.front().at);
+}
+
+bool Machine::GetCanRx(FDCAN_RxHeaderTypeDef& header, uint8_t* data){
+    if(can_rx_.empty())
+        return false;
+    auto& frame = can_rx_.front();
+    header = frame.header;
+    std::copy_n(frame.data.begin(), header.DataLength >> 16, data);
+    can_rx_.pop_front();
+    return true;
+}
+
+void Machine::ScheduleTimers(){
+    for(uint32_t idx = 0; idx < kTimerCount; idx++){
+        if(auto cycles = timers_[idx].CyclesToNextEvent())
+            queue_.Schedule(idx, NanosAt(cycles_ + *cycles));
+        else
+            queue_.Cancel(idx);
+    }
+}
+
+void Machine::AdvanceTo(Nanos t){
+    auto cycles = CyclesAt(t) - cycles_;
+    if(cycles){
+        for(auto& timer : timers_)
+            timer.Advance(cycles);
+        if(sim_DWT.CTRL & DWT_CTRL_CYCCNTENA_Msk)
+            sim_DWT.CYCCNT += static_cast<uint32_t>(cycles);
+        cycles_ += cycles;
+    }
+    now_ = t;
+    UpdatePins();
+    if(model_)
+        model_->AdvanceTo(t);
+}
+
+void Machine::Handle(const EventQueue::Event& event){
+    event_count_++;
+    if(event.source == EventQueue::kOneShot){
+        if(event.arg == kWakeup)
+            return;
+        auto& input = inputs_[event.arg];
+        SetInput(input.port, input.pins, input.level);
+        return;
+    }
+    switch(event.source){
+        case kSysTick:
+            SetPendingIrq(SysTick_IRQn);
+            queue_.Schedule(kSysTick, now_ + kNanosPerMSec);
+            break;
+        case kCanTx:{
+            auto frame = can_tx_.front();
+            can_tx_.pop_front();
+            if(!can_tx_.empty())
+                queue_.Schedule(kCanTx, can_tx_.front().done);
+            if(observer_)
+                observer_->OnCanTx(frame.done, frame.header, frame.data.data());
+            break;
+        }
+        case kCanRx:{
+            auto frame = can_bus_rx_.front();
+            can_bus_rx_.pop_front();
+            if(!can_bus_rx_.empty())
+                queue_.Schedule(kCanRx, can_bus_rx_.front().at);
+            auto id = frame.header.Identifier;
+            for(uint32_t idx = 0; idx < can_filters_.size(); idx++){
+                auto& filter = can_filters_[idx];
+                bool match = filter.FilterType == FDCAN_FILTER_RANGE ? id >= filter.FilterID1 && id <= filter.FilterID2
+                           : filter.FilterType == FDCAN_FILTER_DUAL ? id == filter.FilterID1 || id == filter.FilterID2
+                           : (id & filter.FilterID2) == (filter.FilterID1 & filter.FilterID2);
+                if(!match || filter.FilterConfig == FDCAN_FILTER_DISABLE)
+                    continue;
+                // FIFO blocking mode: a frame arriving at a full FIFO is lost
+                if(can_started_ && filter.FilterConfig == FDCAN_FILTER_TO_RXFIFO0 && can_rx_.size() < kCanRxFifoSize){
+                    frame.header.FilterIndex = idx;
+                    can_rx_.push_back(frame);
+                }
+                break;
+            }
+            break;
+        }
+        case kWatchdog:
+            halted_ = true;
+            if(observer_)
+                observer_->OnWatchdogReset(now_);
+            break;
+        default:
+            // timer counters and flags were updated by AdvanceTo()
+            break;
+    }
+}
+
+void Machine::Dispatch(){
+    if(primask_)
+        return;
+    for(uint32_t i = 0; i < kMaxDispatchesPerEvent; i++){
+        auto irq = HighestPendingIrq();
+        if(!irq)
+            return;
+        pending_[Index(*irq)] = false;
+        auto vector = std::find_if(kVectors.begin(), kVectors.end(),
+                                   [&](const Vector& v){ return v.irq == *irq; });
+        if(vector == kVectors.end()){
+            std::fprintf(stderr, "sim: IRQ %d has no handler\n", *irq);
+            std::exit(EXIT_FAILURE);
+        }
+        vector->handler();
+        SyncRegisters();
+    }
+    std::fprintf(stderr, "sim: interrupt storm at %llu ns\n", static_cast<unsigned long long>(now_));
+    std::exit(EXIT_FAILURE);
+}
+
+std::optional<IRQn_Type> Machine::HighestPendingIrq() const{
+    std::optional<IRQn_Type> best;
+    auto consider = [&](IRQn_Type irq){
+        if(!best || priority_[Index(irq)] < priority_[Index(*best)])
+            best = irq;
+    };
+    // SysTick has no NVIC enable bit
+    auto active = pending_ & enabled_;
+    active[Index(SysTick_IRQn)] = pending_[Index(SysTick_IRQn)];
+    for(auto idx = active._Find_first(); idx < kIrqCount; idx = active._Find_next(idx))
+        consider(static_cast<IRQn_Type>(static_cast<int>(idx) - 16));
+    // timer flags are level sensitive
+    for(auto& timer : timers_){
+        for(auto irq : {timer.UpdateIrq(), timer.CcIrq()}){
+            if(enabled_[Index(irq)] && timer.IsIrqPending(irq))
+                consider(irq);
+        }
+    }
+    return best;
+}
+
+void Machine::UpdatePins(){
+    for(auto& port : ports_){
+        auto& regs = *port.regs;
+        uint32_t moder = regs.MODER;
+        uint16_t outputs = 0;
+        uint16_t alternates = 0;
+        for(uint8_t pin = 0; pin < 16; pin++, moder >>= 2){
+            auto mode = moder & 0x3;
+            if(mode == GPIO_MODE_OUTPUT_PP)
+                outputs |= 1u << pin;
+            else if(mode == GPIO_MODE_AF_PP)
+                alternates |= 1u << pin;
+        }
+        auto level = static_cast<uint16_t>((port.external & ~(outputs | alternates))
+                                           | (regs.ODR & outputs)
+                                           | (alternates ? AlternateLevels(port) & alternates : 0));
+        regs.IDR = level;
+        auto changed = static_cast<uint16_t>((level ^ port.level) & (outputs | alternates));
+        port.level = level;
+        for(; observer_ && changed; changed &= changed - 1){
+            auto pin = static_cast<uint16_t>(changed & -changed);
+            observer_->OnPinChange(now_, port.regs, pin, level & pin);
+        }
+    }
+}
+
+uint16_t Machine::AlternateLevels(const Port& port) const{
+    uint16_t levels = 0;
+    for(auto& out : alternate_outputs_){
+        if(out.port != port.regs)
+            continue;
+        auto pos = __builtin_ctz(out.pin);
+        auto af = (port.regs->AFR[pos >> 3] >> ((pos & 7) * 4)) & 0xF;
+        if(af == out.af && out.timer->OutputLevel(out.channel))
+            levels |= out.pin;
+    }
+    return levels;
+}
+
+}
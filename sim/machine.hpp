@@ -0,0 +1,249 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "main.h"
+#include "event_queue.hpp"
+
+// Host model of the parts of the STM32G431 the firmware touches, as a discrete-event
+// simulation on a nanosecond timeline. Peripherals count in core cycles (170 MHz) and put
+// their next event on the EventQueue. Firmware code runs in zero virtual time: the main
+// loop runs once after every event, interrupt handlers are dispatched at the time their
+// flag was raised and never preempt each other or the main loop.
+namespace sim{
+
+using Cycles = uint64_t;
+
+constexpr uint32_t kCoreClockHz = 170'000'000;
+constexpr uint32_t kLsiHz = 32'000;
+
+constexpr Nanos kNanosPerMSec = 1'000'000;
+
+// cycle at or before t
+constexpr Cycles CyclesAt(Nanos t){
+    return t * (kCoreClockHz / 10'000'000) / 100;
+}
+
+// first nanosecond at or after cycle, CyclesAt(NanosAt(c)) == c
+constexpr Nanos NanosAt(Cycles cycle){
+    return (cycle * 100 + (kCoreClockHz / 10'000'000) - 1) / (kCoreClockHz / 10'000'000);
+}
+
+// Up counting timer with 4 output compare channels. Registers are the firmware view, the
+// shadow registers (PSC, preloaded ARR and CCRx) are latched on update events as on the chip.
+class Timer{
+public:
+    Timer(TIM_TypeDef* regs, uint32_t counter_max, IRQn_Type update_irq, IRQn_Type cc_irq)
+        :regs_(regs)
+        ,counter_max_(counter_max)
+        ,update_irq_(update_irq)
+        ,cc_irq_(cc_irq)
+    {}
+
+    // picks up register writes done by firmware since the last call
+    void Sync();
+    [[nodiscard]] std::optional<Cycles> CyclesToNextEvent() const;
+    // never called past CyclesToNextEvent()
+    void Advance(Cycles cycles);
+
+    [[nodiscard]] bool OutputLevel(uint8_t channel) const;
+    [[nodiscard]] bool IsIrqPending(IRQn_Type irq) const;
+    [[nodiscard]] TIM_TypeDef* Regs() const{ return regs_; }
+    [[nodiscard]] IRQn_Type UpdateIrq() const{ return update_irq_; }
+    [[nodiscard]] IRQn_Type CcIrq() const{ return cc_irq_; }
+
+private:
+    static constexpr uint8_t kChannels = 4;
+
+    enum OCMode : uint8_t{
+        kFrozen = 0, kActive, kInactive, kToggle, kForcedInactive, kForcedActive, kPwm1, kPwm2,
+    };
+
+    [[nodiscard]] uint32_t Divider() const{ return psc_ + 1; }
+    [[nodiscard]] uint64_t TicksToUpdate() const;
+    [[nodiscard]] bool IsChannelUsed(uint8_t channel) const;
+    [[nodiscard]] OCMode Mode(uint8_t channel) const;
+    [[nodiscard]] bool IsPreloaded(uint8_t channel) const;
+    [[nodiscard]] volatile uint32_t& Ccr(uint8_t channel) const;
+    void UpdateEvent();
+    void CompareMatch(uint8_t channel);
+    void LatchShadows();
+
+    TIM_TypeDef* regs_;
+    uint32_t counter_max_;
+    IRQn_Type update_irq_;
+    IRQn_Type cc_irq_;
+    uint32_t psc_ {0};
+    uint32_t arr_ {0};
+    std::array<uint32_t, kChannels> ccr_ {};
+    std::array<bool, kChannels> ref_ {};
+    Cycles phase_ {0};
+};
+
+class Machine{
+public:
+    struct Observer{
+        virtual void OnPinChange(Nanos, GPIO_TypeDef*, uint16_t /*pin*/, bool /*level*/){}
+        virtual void OnCanTx(Nanos, const FDCAN_TxHeaderTypeDef&, const uint8_t* /*data*/){}
+        virtual void OnWatchdogReset(Nanos){}
+    };
+
+    // outside world driven by the outputs, e.g. the grid mechanics. Brought up to the time
+    // of every event before firmware code runs, so inputs it drives are current when sampled.
+    struct Model{
+        virtual void AdvanceTo(Nanos) = 0;
+    };
+
+    static Machine& Get();
+
+    // emulated flash at FLASH_BASE, erased or backed by image_path so journal and profile
+    // pages survive between runs
+    bool MapFlash(const char* image_path);
+
+    void SetObserver(Observer* observer){ observer_ = observer; }
+    void SetModel(Model* model){ model_ = model; }
+    // level of an input pin as driven from outside the board, now or at a later time
+    void SetInput(GPIO_TypeDef* port, uint16_t pins, bool level);
+    void ScheduleInput(Nanos at, GPIO_TypeDef* port, uint16_t pins, bool level);
+    // an event at `at` without side effects, the main loop runs right after it
+    void ScheduleWakeup(Nanos at);
+
+    // handles the next events up to limit and dispatches pending interrupts,
+    // false once limit is reached or the watchdog has fired
+    bool Step(Nanos limit);
+    // busy CPU that cannot take interrupts, e.g. stalled on flash programming
+    void Stall(Nanos duration);
+
+    [[nodiscard]] Nanos Now() const{ return now_; }
+    [[nodiscard]] bool IsHalted() const{ return halted_; }
+    [[nodiscard]] uint64_t EventCount() const{ return event_count_; }
+
+    // register level side effects of firmware writes (EGR, BSRR, ...)
+    void SyncRegisters();
+
+    // NVIC and core
+    void SetPriority(IRQn_Type irq, uint32_t priority){ priority_[Index(irq)] = priority; }
+    [[nodiscard]] uint32_t Priority(IRQn_Type irq) const{ return priority_[Index(irq)]; }
+    void EnableIrq(IRQn_Type irq, bool enable){ enabled_[Index(irq)] = enable; }
+    void SetPendingIrq(IRQn_Type irq){ pending_[Index(irq)] = true; }
+    void SetPrimask(uint32_t primask){ primask_ = primask; }
+    [[nodiscard]] uint32_t Primask() const{ return primask_; }
+    void SetPriorityGrouping(uint32_t group){ priority_grouping_ = group; }
+    [[nodiscard]] uint32_t PriorityGrouping() const{ return priority_grouping_; }
+    void StartSysTick();
+
+    // IWDG
+    void StartWatchdog(uint32_t prescaler, uint32_t reload);
+    void RefreshWatchdog();
+
+    // FDCAN
+    void StartCan(const FDCAN_InitTypeDef& init);
+    void StopCan(){ can_started_ = false; }
+    [[nodiscard]] uint32_t CanTxFreeLevel() const;
+    bool AddCanTx(const FDCAN_TxHeaderTypeDef& header, const uint8_t* data);
+    // frames not matching a filter into RX FIFO 0 are rejected, like the firmware's global filter
+    void SetCanFilter(const FDCAN_FilterTypeDef& filter);
+    // standard id data frame from another node, received completely at `at`
+    void ScheduleCanRx(Nanos at, uint32_t id, const std::vector<uint8_t>& data);
+    [[nodiscard]] uint32_t CanRxFillLevel() const{ return static_cast<uint32_t>(can_rx_.size()); }
+    bool GetCanRx(FDCAN_RxHeaderTypeDef& header, uint8_t* data);
+
+private:
+    static constexpr std::size_t kIrqCount = SIM_IRQn_COUNT + 16;
+    static constexpr std::size_t kTimerCount = 6;
+    static constexpr uint32_t kCanTxFifoSize = 3;
+    static constexpr uint32_t kCanRxFifoSize = 3;
+    static constexpr uint32_t kMaxDispatchesPerEvent = 1000;
+    // one-shot arg of ScheduleWakeup(), others index inputs_
+    static constexpr uint32_t kWakeup = UINT32_MAX;
+
+    // event sources, timers first
+    enum Source : uint32_t{
+        kSysTick = kTimerCount,
+        kCanTx,
+        kCanRx,
+        kWatchdog,
+        kSourceCount
+    };
+
+    struct Port{
+        GPIO_TypeDef* regs;
+        uint16_t external {0};
+        uint16_t level {0};
+    };
+
+    struct AlternateOutput{
+        GPIO_TypeDef* port;
+        uint16_t pin;
+        uint8_t af;
+        Timer* timer;
+        uint8_t channel;
+    };
+
+    struct CanFrame{
+        Nanos done;
+        FDCAN_TxHeaderTypeDef header;
+        std::array<uint8_t, 8> data;
+    };
+
+    struct CanRxFrame{
+        Nanos at;
+        FDCAN_RxHeaderTypeDef header;
+        std::array<uint8_t, 8> data;
+    };
+
+    struct InputChange{
+        GPIO_TypeDef* port;
+        uint16_t pins;
+        bool level;
+    };
+
+    Machine();
+
+    static std::size_t Index(IRQn_Type irq){ return static_cast<std::size_t>(irq + 16); }
+
+    void ScheduleTimers();
+    void AdvanceTo(Nanos t);
+    void Handle(const EventQueue::Event& event);
+    void Dispatch();
+    [[nodiscard]] std::optional<IRQn_Type> HighestPendingIrq() const;
+    void UpdatePins();
+    [[nodiscard]] uint16_t AlternateLevels(const Port& port) const;
+
+    Nanos now_ {0};
+    Cycles cycles_ {0};
+    bool halted_ {false};
+    uint64_t event_count_ {0};
+    Observer* observer_ {nullptr};
+    Model* model_ {nullptr};
+    EventQueue queue_ {kSourceCount};
+    std::vector<InputChange> inputs_;
+
+    std::array<Timer, kTimerCount> timers_;
+    std::array<Port, 3> ports_;
+    std::array<AlternateOutput, 2> alternate_outputs_;
+
+    std::array<uint32_t, kIrqCount> priority_ {};
+    std::bitset<kIrqCount> enabled_;
+    std::bitset<kIrqCount> pending_;
+    uint32_t priority_grouping_ {0};
+    uint32_t primask_ {0};
+
+    bool watchdog_running_ {false};
+    Nanos watchdog_timeout_ {0};
+
+    bool can_started_ {false};
+    Nanos can_bit_time_ {1};
+    std::deque<CanFrame> can_tx_;
+    std::vector<FDCAN_FilterTypeDef> can_filters_;
+    // on the bus, in order of reception, and in RX FIFO 0
+    std::deque<CanRxFrame> can_bus_rx_;
+    std::deque<CanRxFrame> can_rx_;
+};
+
+}
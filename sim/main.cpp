@@ -0,0 +1,508 @@
+// RasterDriverSim: runs the firmware (Core init, it.c handlers, app/) against the host model
+// in sim/machine.hpp. Inputs are scripted from the command line, output pin edges, steps,
+// state changes and CAN frames are printed with their virtual timestamp in nanoseconds.
+// --expect-* turn a run into a pass/fail scenario through the exit status.
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "main.h"
+#include "fdcan.h"
+#include "gpio.h"
+#include "iwdg.h"
+#include "tim.h"
+#include "board_direct.h"
+#include "boot_profile.h"
+#include "input_replay.hpp"
+#include "machine.hpp"
+#include "plant.hpp"
+#include "trace_file.hpp"
+
+extern "C" void AppInit();
+extern "C" void AppLoop();
+
+namespace{
+    struct NamedPin{
+        const char* name;
+        GPIO_TypeDef* port;
+        uint16_t pin;
+    };
+
+    constexpr std::array kPins{
+        NamedPin{"exp_req", EXP_REQ_IN_GPIO_Port, EXP_REQ_IN_Pin},
+        NamedPin{"home", GRID_HOME_DETECT_GPIO_Port, GRID_HOME_DETECT_Pin},
+        NamedPin{"in_field", GRID_INFIELD_DETECT_GPIO_Port, GRID_INFIELD_DETECT_Pin},
+        NamedPin{"button", GRID_BUTTON_GPIO_Port, GRID_BUTTON_Pin},
+        NamedPin{"test_button", NOTUSED_PUSHBUTTON_GPIO_Port, NOTUSED_PUSHBUTTON_Pin},
+        NamedPin{"config1", CONFIG_1_GPIO_Port, CONFIG_1_Pin},
+        NamedPin{"config2", CONFIG_2_GPIO_Port, CONFIG_2_Pin},
+        NamedPin{"config3", CONFIG_3_GPIO_Port, CONFIG_3_Pin},
+        NamedPin{"indication0", INDICATION_0_OUT_GPIO_Port, INDICATION_0_OUT_Pin},
+        NamedPin{"indication1", INDICATION_1_OUT_GPIO_Port, INDICATION_1_OUT_Pin},
+        NamedPin{"in_motion", IN_MOTION_OUT_GPIO_Port, IN_MOTION_OUT_Pin},
+        NamedPin{"step", STEP_GPIO_Port, STEP_Pin},
+        NamedPin{"dir", DIR_GPIO_Port, DIR_Pin},
+        NamedPin{"enable", ENABLE_GPIO_Port, ENABLE_Pin},
+    };
+
+    const NamedPin* FindPin(std::string_view name){
+        for(auto& pin : kPins){
+            if(name == pin.name)
+                return &pin;
+        }
+        return nullptr;
+    }
+
+    const NamedPin* FindPin(GPIO_TypeDef* port, uint16_t pin){
+        for(auto& p : kPins){
+            if(p.port == port && p.pin == pin)
+                return &p;
+        }
+        return nullptr;
+    }
+
+    // RBTypes::State in app/app_config.hpp
+    constexpr std::array kStateNames{
+        "init_state", "service_moving", "grid_in_field", "grid_home", "scanning",
+        "oscillation", "error", "moving_in_field", "moving_home", "calibration",
+    };
+
+    // TELEMETRY_CAN_ID + CanTelemetry::Msg::state, app_config.hpp is private to app.cpp
+    constexpr uint32_t kStateCanId = 0x601;
+
+    struct InputChange{
+        sim::Nanos at;
+        const NamedPin* pin;
+        bool level;
+    };
+
+    // main loop busy without taking interrupts, as during a flash erase
+    struct Stall{
+        sim::Nanos at;
+        sim::Nanos duration;
+    };
+
+    // frame from another node on the bus, e.g. a CanTelemetry::Cmd
+    struct CanRx{
+        sim::Nanos at;
+        uint32_t id;
+        std::vector<uint8_t> data;
+    };
+
+    unsigned long long Ns(sim::Nanos t){
+        return static_cast<unsigned long long>(t);
+    }
+
+    // the board routes the home switch to GRID_INFIELD_DETECT and the in field switch to
+    // GRID_HOME_DETECT (kInputMasks in controller.hpp), both are active low
+    constexpr std::array<sim::Plant::SwitchPin, sim::Plant::kSwitchCount> kPlantSwitches{{
+        {GRID_INFIELD_DETECT_GPIO_Port, GRID_INFIELD_DETECT_Pin, false},
+        {GRID_HOME_DETECT_GPIO_Port, GRID_HOME_DETECT_Pin, false},
+    }};
+
+    constexpr std::array kSwitchNames{"home", "in_field"};
+
+    class Printer : public sim::Machine::Observer, public sim::Plant::Observer{
+    public:
+        bool print_steps {false};
+        sim::StepTraceFile* trace {nullptr};
+        sim::Plant* plant {nullptr};
+        int64_t position {0};
+        uint64_t steps {0};
+        // steps made at or after stopped_after
+        std::optional<sim::Nanos> stopped_after;
+        uint64_t late_steps {0};
+        std::optional<uint8_t> state;
+        int64_t min_position {0};
+        int64_t max_position {0};
+        // data of the last frame sent per id
+        std::map<uint32_t, std::vector<uint8_t>> last_frames;
+        // last level of each output seen changing, low from reset
+        std::map<const NamedPin*, bool> levels;
+
+        void OnPinChange(sim::Nanos t, GPIO_TypeDef* port, uint16_t pin, bool level) override{
+            auto named = FindPin(port, pin);
+            if(named && named->pin == STEP_Pin && named->port == STEP_GPIO_Port){
+                if(!level)
+                    return;
+                steps++;
+                if(stopped_after && t >= *stopped_after)
+                    late_steps++;
+                auto dir = HAL_GPIO_ReadPin(DIR_GPIO_Port, DIR_Pin) ? 1 : -1;
+                position += dir;
+                min_position = std::min(min_position, position);
+                max_position = std::max(max_position, position);
+                if(plant)
+                    plant->Step(t, dir > 0);
+                if(trace)
+                    trace->Step(t, dir > 0);
+                if(print_steps)
+                    std::printf("%12llu step %+d\n", Ns(t), dir);
+                return;
+            }
+            if(!named)
+                return;
+            levels[named] = level;
+            std::printf("%12llu pin %s %d\n", Ns(t), named->name, level);
+        }
+
+        void OnCanTx(sim::Nanos t, const FDCAN_TxHeaderTypeDef& header, const uint8_t* data) override{
+            last_frames[header.Identifier].assign(data, data + (header.DataLength >> 16));
+            if(header.Identifier == kStateCanId && data[0] < kStateNames.size()){
+                auto pos = static_cast<int32_t>(data[4] | data[5] << 8 | data[6] << 16 | static_cast<uint32_t>(data[7]) << 24);
+                std::printf("%12llu state %s position %ld\n", Ns(t), kStateNames[data[0]], static_cast<long>(pos));
+                state = data[0];
+                if(trace)
+                    trace->Event(StepTrace::Kind::state, t, data[0], pos);
+                return;
+            }
+            std::printf("%12llu can 0x%03X", Ns(t), static_cast<unsigned>(header.Identifier));
+            for(uint32_t i = 0; i < (header.DataLength >> 16); i++)
+                std::printf(" %02X", data[i]);
+            std::printf("\n");
+        }
+
+        void OnWatchdogReset(sim::Nanos t) override{
+            std::printf("%12llu iwdg reset\n", Ns(t));
+        }
+
+        void OnSwitch(sim::Nanos t, sim::Plant::Switch sw, bool active, double pos) override{
+            std::printf("%12llu plant %s %d position %.1f\n", Ns(t), kSwitchNames[static_cast<std::size_t>(sw)],
+                        active, pos);
+        }
+
+        void OnSlip(sim::Nanos t, int32_t microsteps, double pos) override{
+            std::printf("%12llu plant slip %+d position %.1f\n", Ns(t), static_cast<int>(microsteps), pos);
+        }
+    };
+
+    void Usage(const char* argv0){
+        std::fprintf(stderr,
+            "usage: %s [--ms <duration>] [--flash <image>] [--steps] [--stats] [--trace <file>] [--set <ms>:<pin>=<0|1>]...\n"
+            "          [--plant] [--plant-set <name>=<value>]... [--replay <can log>] [--replay-at <ms>]\n"
+            "          [--stall <ms>:<us>]... [--expect-stopped <ms>] [--expect-state <state>]\n"
+            "          [--expect-range <min>:<max>] [--can <ms>:<id>:<data>]... [--expect-can <id>:<data>]\n"
+            "          [--expect-pin <pin>=<0|1>]...\n"
+            "pins:", argv0);
+        for(auto& pin : kPins)
+            std::fprintf(stderr, " %s", pin.name);
+        std::fprintf(stderr, "\n--stall keeps the main loop busy with interrupts held off, like a flash erase\n");
+        std::fprintf(stderr, "--expect-stopped fails on any step from that time on, --expect-state on another last state,\n"
+                             "--expect-range when the step count position leaves min..max,\n"
+                             "--expect-can when the last frame sent with id does not start with data,\n"
+                             "--expect-pin on another output level at the end\n");
+        std::fprintf(stderr, "--can sends a standard id frame to the board, id and data in hex (e.g. 640:03)\n");
+        std::fprintf(stderr, "--replay feeds an InputLog dump back, by default at the times it was logged\n");
+        std::fprintf(stderr, "--plant drives home and in_field from the grid mechanics, parameters:\n");
+        sim::Plant::PrintParams({});
+        std::exit(EXIT_FAILURE);
+    }
+
+    bool ParseSet(const char* arg, InputChange& change){
+        std::string_view s{arg};
+        auto colon = s.find(':');
+        auto eq = s.find('=');
+        if(colon == std::string_view::npos || eq == std::string_view::npos || eq < colon)
+            return false;
+        change.at = std::strtoull(std::string{s.substr(0, colon)}.c_str(), nullptr, 10) * sim::kNanosPerMSec;
+        change.pin = FindPin(s.substr(colon + 1, eq - colon - 1));
+        change.level = s.substr(eq + 1) == "1";
+        return change.pin != nullptr;
+    }
+
+    // <pin>=<0|1>
+    bool ParseLevel(const char* arg, InputChange& expect){
+        std::string_view s{arg};
+        auto eq = s.find('=');
+        if(eq == std::string_view::npos)
+            return false;
+        expect.pin = FindPin(s.substr(0, eq));
+        expect.level = s.substr(eq + 1) == "1";
+        return expect.pin != nullptr;
+    }
+
+    bool ParseStall(const char* arg, Stall& stall){
+        std::string_view s{arg};
+        auto colon = s.find(':');
+        if(colon == std::string_view::npos)
+            return false;
+        stall.at = std::strtoull(std::string{s.substr(0, colon)}.c_str(), nullptr, 10) * sim::kNanosPerMSec;
+        stall.duration = std::strtoull(std::string{s.substr(colon + 1)}.c_str(), nullptr, 10) * 1000;
+        return stall.duration > 0;
+    }
+
+    bool ParseRange(const char* arg, std::pair<int64_t, int64_t>& range){
+        std::string_view s{arg};
+        auto colon = s.find(':', 1);
+        if(colon == std::string_view::npos)
+            return false;
+        range.first = std::strtoll(std::string{s.substr(0, colon)}.c_str(), nullptr, 10);
+        range.second = std::strtoll(std::string{s.substr(colon + 1)}.c_str(), nullptr, 10);
+        return range.first <= range.second;
+    }
+
+    // <hex id>:<hex data>, data may be empty
+    bool ParseFrame(std::string_view s, uint32_t& id, std::vector<uint8_t>& data){
+        auto colon = s.find(':');
+        if(colon == std::string_view::npos || !colon)
+            return false;
+        id = std::strtoul(std::string{s.substr(0, colon)}.c_str(), nullptr, 16);
+        auto hex = s.substr(colon + 1);
+        if(hex.size() % 2 || hex.size() > 16 || id > 0x7FF)
+            return false;
+        data.clear();
+        for(std::size_t i = 0; i < hex.size(); i += 2){
+            std::string byte{hex.substr(i, 2)};
+            char* end = nullptr;
+            data.push_back(static_cast<uint8_t>(std::strtoul(byte.c_str(), &end, 16)));
+            if(*end)
+                return false;
+        }
+        return true;
+    }
+
+    bool ParseCan(const char* arg, CanRx& frame){
+        std::string_view s{arg};
+        auto colon = s.find(':');
+        if(colon == std::string_view::npos)
+            return false;
+        frame.at = std::strtoull(std::string{s.substr(0, colon)}.c_str(), nullptr, 10) * sim::kNanosPerMSec;
+        return ParseFrame(s.substr(colon + 1), frame.id, frame.data);
+    }
+
+    std::optional<uint8_t> FindState(std::string_view name){
+        for(uint8_t idx = 0; idx < kStateNames.size(); idx++){
+            if(name == kStateNames[idx])
+                return idx;
+        }
+        return std::nullopt;
+    }
+}
+
+extern "C" void Error_Handler(void){
+    std::fprintf(stderr, "sim: Error_Handler at %llu ns\n", Ns(sim::Machine::Get().Now()));
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv){
+    uint64_t duration_ms = 1000;
+    const char* flash_image = nullptr;
+    bool stats = false;
+    const char* trace_path = nullptr;
+    std::vector<InputChange> changes;
+    std::vector<Stall> stalls;
+    std::optional<uint8_t> expect_state;
+    std::optional<std::pair<int64_t, int64_t>> expect_range;
+    std::vector<CanRx> can_frames;
+    std::optional<CanRx> expect_can;
+    std::vector<InputChange> expect_pins;
+    Printer printer;
+    const char* replay_path = nullptr;
+    std::optional<sim::Nanos> replay_at;
+    bool plant_enabled = false;
+    sim::Plant::Params plant_params;
+
+    for(int i = 1; i < argc; i++){
+        std::string_view arg{argv[i]};
+        if(arg == "--ms" && i + 1 < argc)
+            duration_ms = std::strtoull(argv[++i], nullptr, 10);
+        else if(arg == "--flash" && i + 1 < argc)
+            flash_image = argv[++i];
+        else if(arg == "--steps")
+            printer.print_steps = true;
+        else if(arg == "--stats")
+            stats = true;
+        else if(arg == "--trace" && i + 1 < argc)
+            trace_path = argv[++i];
+        else if(arg == "--set" && i + 1 < argc){
+            InputChange change{};
+            if(!ParseSet(argv[++i], change))
+                Usage(argv[0]);
+            changes.push_back(change);
+        }else if(arg == "--stall" && i + 1 < argc){
+            Stall stall{};
+            if(!ParseStall(argv[++i], stall))
+                Usage(argv[0]);
+            stalls.push_back(stall);
+        }else if(arg == "--expect-stopped" && i + 1 < argc)
+            printer.stopped_after = std::strtoull(argv[++i], nullptr, 10) * sim::kNanosPerMSec;
+        else if(arg == "--expect-state" && i + 1 < argc){
+            expect_state = FindState(argv[++i]);
+            if(!expect_state)
+                Usage(argv[0]);
+        }else if(arg == "--expect-range" && i + 1 < argc){
+            expect_range.emplace();
+            if(!ParseRange(argv[++i], *expect_range))
+                Usage(argv[0]);
+        }else if(arg == "--can" && i + 1 < argc){
+            CanRx frame{};
+            if(!ParseCan(argv[++i], frame))
+                Usage(argv[0]);
+            can_frames.push_back(frame);
+        }else if(arg == "--expect-can" && i + 1 < argc){
+            expect_can.emplace();
+            if(!ParseFrame(argv[++i], expect_can->id, expect_can->data))
+                Usage(argv[0]);
+        }else if(arg == "--expect-pin" && i + 1 < argc){
+            InputChange expect{};
+            if(!ParseLevel(argv[++i], expect))
+                Usage(argv[0]);
+            expect_pins.push_back(expect);
+        }else if(arg == "--replay" && i + 1 < argc)
+            replay_path = argv[++i];
+        else if(arg == "--replay-at" && i + 1 < argc)
+            replay_at = std::strtoull(argv[++i], nullptr, 10) * sim::kNanosPerMSec;
+        else if(arg == "--plant")
+            plant_enabled = true;
+        else if(arg == "--plant-set" && i + 1 < argc){
+            if(!sim::Plant::SetParam(plant_params, argv[++i]))
+                Usage(argv[0]);
+            plant_enabled = true;
+        }else
+            Usage(argv[0]);
+    }
+
+    auto& machine = sim::Machine::Get();
+    if(!machine.MapFlash(flash_image)){
+        std::fprintf(stderr, "sim: cannot map flash at 0x%08X\n", FLASH_BASE);
+        return EXIT_FAILURE;
+    }
+    sim::StepTraceFile trace;
+    if(trace_path){
+        if(!trace.Open(trace_path, 0)){
+            std::fprintf(stderr, "sim: cannot write %s\n", trace_path);
+            return EXIT_FAILURE;
+        }
+        printer.trace = &trace;
+    }
+    machine.SetObserver(&printer);
+    std::optional<sim::Plant> plant;
+    if(plant_enabled){
+        plant.emplace(plant_params, kPlantSwitches);
+        plant->SetObserver(&printer);
+        machine.SetModel(&*plant);
+        printer.plant = &*plant;
+    }
+
+    // inputs present at reset are seen by the first sample
+    for(auto& c : changes){
+        if(c.at)
+            machine.ScheduleInput(c.at, c.pin->port, c.pin->pin, c.level);
+        else
+            machine.SetInput(c.pin->port, c.pin->pin, c.level);
+    }
+    if(replay_path){
+        sim::InputReplay replay;
+        if(!replay.Load(replay_path, replay_at)){
+            std::fprintf(stderr, "sim: no input log frames in %s\n", replay_path);
+            return EXIT_FAILURE;
+        }
+        if(replay.Gaps())
+            std::fprintf(stderr, "sim: %u input log entries missing in %s\n", replay.Gaps(), replay_path);
+        machine.SetInput(EXP_REQ_IN_GPIO_Port, sim::InputReplay::kMask & replay.Initial(), true);
+        machine.SetInput(EXP_REQ_IN_GPIO_Port, sim::InputReplay::kMask & ~replay.Initial(), false);
+        for(auto& change : replay.Changes()){
+            for(uint16_t bits = change.changed; bits; bits &= bits - 1){
+                auto pin = static_cast<uint16_t>(bits & -bits);
+                if(change.at)
+                    machine.ScheduleInput(change.at, EXP_REQ_IN_GPIO_Port, pin, change.levels & pin);
+                else
+                    machine.SetInput(EXP_REQ_IN_GPIO_Port, pin, change.levels & pin);
+            }
+        }
+    }
+
+    for(auto& frame : can_frames)
+        machine.ScheduleCanRx(frame.at, frame.id, frame.data);
+
+    std::sort(stalls.begin(), stalls.end(), [](const Stall& a, const Stall& b){ return a.at < b.at; });
+    for(auto& stall : stalls)
+        machine.ScheduleWakeup(stall.at);
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    // same sequence as main()
+    Board_CycleCounterStart();
+    HAL_Init();
+    BootProfile_Stamp(BOOT_STAGE_HAL_INIT);
+    BootProfile_Stamp(BOOT_STAGE_CLOCK);
+    MX_GPIO_Init();
+    MX_FDCAN1_Init();
+    MX_TIM1_Init();
+    MX_TIM4_Init();
+    MX_TIM7_Init();
+    MX_TIM6_Init();
+    MX_IWDG_Init();
+    MX_TIM3_Init();
+    MX_TIM2_Init();
+    AppInit();
+
+    // the main loop runs once after every event
+    auto end = duration_ms * sim::kNanosPerMSec;
+    auto next_stall = stalls.begin();
+    do{
+        AppLoop();
+        for(; next_stall != stalls.end() && next_stall->at <= machine.Now(); next_stall++){
+            std::printf("%12llu stall %llu us\n", Ns(machine.Now()), Ns(next_stall->duration / 1000));
+            machine.Stall(next_stall->duration);
+        }
+    }while(machine.Step(end));
+
+    std::printf("%12llu end steps %llu position %lld\n", Ns(machine.Now()),
+                static_cast<unsigned long long>(printer.steps), static_cast<long long>(printer.position));
+    if(plant){
+        std::printf("%12llu plant position %.1f commanded %.1f lost %lld max_error %.1f\n", Ns(machine.Now()),
+                    plant->Position(), plant_params.start_position + static_cast<double>(plant->Commanded()),
+                    static_cast<long long>(plant->Lost()), plant->MaxError());
+    }
+    if(stats){
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+        double simulated = static_cast<double>(machine.Now()) * 1e-9;
+        std::fprintf(stderr, "sim: %.3f s simulated in %.3f s wall, %.0fx real time, %llu events\n",
+                     simulated, wall.count(), simulated / wall.count(),
+                     static_cast<unsigned long long>(machine.EventCount()));
+    }
+    bool passed = !machine.IsHalted();
+    if(printer.late_steps){
+        std::fprintf(stderr, "sim: %llu steps after %llu ns, expected stopped\n",
+                     static_cast<unsigned long long>(printer.late_steps), Ns(*printer.stopped_after));
+        passed = false;
+    }
+    if(expect_state && printer.state != expect_state){
+        std::fprintf(stderr, "sim: last state %s, expected %s\n",
+                     printer.state ? kStateNames[*printer.state] : "none", kStateNames[*expect_state]);
+        passed = false;
+    }
+    if(expect_range && (printer.min_position < expect_range->first || printer.max_position > expect_range->second)){
+        std::fprintf(stderr, "sim: position %lld..%lld, expected within %lld..%lld\n",
+                     static_cast<long long>(printer.min_position), static_cast<long long>(printer.max_position),
+                     static_cast<long long>(expect_range->first), static_cast<long long>(expect_range->second));
+        passed = false;
+    }
+    if(expect_can){
+        auto sent = printer.last_frames.find(expect_can->id);
+        if(sent == printer.last_frames.end() || sent->second.size() < expect_can->data.size()
+           || !std::equal(expect_can->data.begin(), expect_can->data.end(), sent->second.begin())){
+            std::fprintf(stderr, "sim: last frame 0x%03X does not start with the expected data\n",
+                         static_cast<unsigned>(expect_can->id));
+            passed = false;
+        }
+    }
+    for(auto& expect : expect_pins){
+        auto level = printer.levels.find(expect.pin);
+        if((level != printer.levels.end() && level->second) != expect.level){
+            std::fprintf(stderr, "sim: pin %s %d at the end, expected %d\n", expect.pin->name, !expect.level, expect.level);
+            passed = false;
+        }
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,200 @@
+#include "plant.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace sim{
+
+namespace{
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr double kRadPerMicrostep = 2 * kPi / (Plant::kFullStepsPerRev * Plant::kMicrosteps);
+    // rotor teeth, one electrical period is 4 full steps
+    constexpr double kPolePairs = Plant::kFullStepsPerRev / 4.0;
+    constexpr double kStickSpeed = 1e-4;
+
+    struct ParamName{
+        std::string_view name;
+        double Plant::Params::* member;
+    };
+
+    constexpr std::array kParamNames{
+        ParamName{"holding_torque", &Plant::Params::holding_torque},
+        ParamName{"corner_speed", &Plant::Params::corner_speed},
+        ParamName{"rotor_inertia", &Plant::Params::rotor_inertia},
+        ParamName{"rotor_damping", &Plant::Params::rotor_damping},
+        ParamName{"grid_inertia", &Plant::Params::grid_inertia},
+        ParamName{"drive_stiffness", &Plant::Params::drive_stiffness},
+        ParamName{"drive_damping", &Plant::Params::drive_damping},
+        ParamName{"coulomb_friction", &Plant::Params::coulomb_friction},
+        ParamName{"viscous_friction", &Plant::Params::viscous_friction},
+        ParamName{"field_edge", &Plant::Params::field_edge},
+        ParamName{"switch_offset", &Plant::Params::switch_offset},
+        ParamName{"switch_hysteresis", &Plant::Params::switch_hysteresis},
+        ParamName{"hard_stop_margin", &Plant::Params::hard_stop_margin},
+        ParamName{"bounce_us", &Plant::Params::bounce_us},
+        ParamName{"bounce_count", &Plant::Params::bounce_count},
+        ParamName{"start_position", &Plant::Params::start_position},
+        ParamName{"seed", &Plant::Params::seed},
+    };
+
+    double Sign(double v){
+        return v > 0 ? 1 : v < 0 ? -1 : 0;
+    }
+}
+
+Plant::Plant(const Params& params, const std::array<SwitchPin, kSwitchCount>& pins)
+    :params_(params)
+    ,rng_(static_cast<uint64_t>(params.seed) * 0x9E3779B97F4A7C15ull + 1)
+    ,commanded_angle_(params.start_position * kRadPerMicrostep)
+    ,rotor_(commanded_angle_)
+    ,grid_(commanded_angle_)
+{
+    for(std::size_t i = 0; i < kSwitchCount; i++)
+        switches_[i].pin = pins[i];
+    // settled state at reset, no bounce
+    UpdateSwitches();
+    for(auto& sw : switches_)
+        sw.bounces.clear();
+    DriveInputs();
+}
+
+bool Plant::SetParam(Params& params, std::string_view assignment){
+    auto eq = assignment.find('=');
+    if(eq == std::string_view::npos)
+        return false;
+    for(auto& p : kParamNames){
+        if(p.name == assignment.substr(0, eq)){
+            params.*p.member = std::strtod(std::string{assignment.substr(eq + 1)}.c_str(), nullptr);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Plant::PrintParams(const Params& params){
+    for(auto& p : kParamNames)
+        std::fprintf(stderr, "  %.*s=%g\n", static_cast<int>(p.name.size()), p.name.data(), params.*p.member);
+}
+
+void Plant::Step(Nanos t, bool forward){
+    AdvanceTo(t);
+    commanded_ += forward ? 1 : -1;
+    commanded_angle_ += forward ? kRadPerMicrostep : -kRadPerMicrostep;
+    parked_ = false;
+    quiet_since_ = t;
+}
+
+void Plant::AdvanceTo(Nanos t){
+    if(parked_)
+        now_ = t;
+    while(now_ + kDt <= t && !parked_){
+        Integrate();
+        now_ += kDt;
+        UpdateSwitches();
+        if(std::fabs(rotor_speed_) > kRestSpeed || std::fabs(grid_speed_) > kRestSpeed)
+            quiet_since_ = now_;
+        else if(now_ - quiet_since_ >= kRestTime)
+            parked_ = true;
+    }
+    DriveInputs();
+}
+
+double Plant::Position() const{
+    return grid_ / kRadPerMicrostep;
+}
+
+void Plant::Integrate(){
+    constexpr double dt = static_cast<double>(kDt) * 1e-9;
+    auto& p = params_;
+
+    auto pull_out = p.holding_torque / (1 + std::fabs(rotor_speed_) / p.corner_speed);
+    auto lag = kPolePairs * (commanded_angle_ - rotor_);
+    auto motor = pull_out * std::sin(lag);
+    auto drive = p.drive_stiffness * (rotor_ - grid_) + p.drive_damping * (rotor_speed_ - grid_speed_);
+
+    rotor_speed_ += (motor - drive - p.rotor_damping * rotor_speed_) / p.rotor_inertia * dt;
+    rotor_ += rotor_speed_ * dt;
+
+    // static friction holds the grid until the drive overcomes it
+    if(std::fabs(grid_speed_) < kStickSpeed && std::fabs(drive) <= p.coulomb_friction){
+        grid_speed_ = 0;
+    }else{
+        auto friction = p.coulomb_friction * Sign(std::fabs(grid_speed_) < kStickSpeed ? drive : grid_speed_);
+        auto speed = grid_speed_ + (drive - friction - p.viscous_friction * grid_speed_) / p.grid_inertia * dt;
+        // friction stops the grid, it does not reverse it
+        grid_speed_ = Sign(speed) == -Sign(grid_speed_) ? 0 : speed;
+    }
+    grid_ += grid_speed_ * dt;
+
+    auto low = -p.hard_stop_margin * kRadPerMicrostep;
+    auto high = (p.field_edge + p.hard_stop_margin) * kRadPerMicrostep;
+    if(grid_ < low || grid_ > high){
+        grid_ = std::clamp(grid_, low, high);
+        grid_speed_ = 0;
+    }
+
+    // a pole slip shows up as the lag leaving (-pi, pi] for the next equilibrium
+    auto periods = static_cast<int64_t>(std::floor((kPolePairs * (commanded_angle_ - rotor_) + kPi) / (2 * kPi)));
+    if(periods != slip_periods_){
+        auto microsteps = static_cast<int32_t>((periods - slip_periods_) * kMicrostepsPerPeriod);
+        slip_periods_ = periods;
+        lost_ += std::abs(microsteps);
+        if(observer_)
+            observer_->OnSlip(now_ + kDt, -microsteps, Position());
+    }
+    auto error = std::fabs(Position() - (params_.start_position + static_cast<double>(commanded_)));
+    max_error_ = std::max(max_error_, error);
+}
+
+void Plant::UpdateSwitches(){
+    auto x = Position() - params_.switch_offset;
+    auto hysteresis = params_.switch_hysteresis;
+    auto& home = switches_[static_cast<std::size_t>(Switch::home)];
+    auto& field = switches_[static_cast<std::size_t>(Switch::in_field)];
+    if(!home.active && x <= 0)
+        Transition(home, Switch::home, true);
+    else if(home.active && x > hysteresis)
+        Transition(home, Switch::home, false);
+    if(!field.active && x >= params_.field_edge)
+        Transition(field, Switch::in_field, true);
+    else if(field.active && x < params_.field_edge - hysteresis)
+        Transition(field, Switch::in_field, false);
+}
+
+void Plant::Transition(SwitchState& sw, Switch which, bool active){
+    sw.active = active;
+    sw.bounces.clear();
+    auto toggles = 2 * static_cast<uint32_t>(params_.bounce_count);
+    for(uint32_t i = 0; i < toggles; i++)
+        sw.bounces.push_back(now_ + static_cast<Nanos>(Random() * params_.bounce_us * 1e3));
+    std::sort(sw.bounces.begin(), sw.bounces.end());
+    if(observer_)
+        observer_->OnSwitch(now_, which, active, Position());
+}
+
+void Plant::DriveInputs(){
+    auto& machine = Machine::Get();
+    for(auto& sw : switches_){
+        auto flips = std::upper_bound(sw.bounces.begin(), sw.bounces.end(), now_) - sw.bounces.begin();
+        bool contact = sw.active != (flips % 2 == 1);
+        if(flips == static_cast<std::ptrdiff_t>(sw.bounces.size()))
+            sw.bounces.clear();
+        bool level = contact == sw.pin.active_level;
+        if(sw.driven == level)
+            continue;
+        sw.driven = level;
+        machine.SetInput(sw.pin.port, sw.pin.pin, level);
+    }
+}
+
+double Plant::Random(){
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 7;
+    rng_ ^= rng_ << 17;
+    return static_cast<double>(rng_ >> 11) * 0x1p-53;
+}
+
+}
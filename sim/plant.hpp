@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "main.h"
+#include "machine.hpp"
+
+// Mechanics behind the step/dir outputs: a hybrid stepper whose pull-out torque falls with
+// speed, the grid inertia on a compliant drive with Coulomb and viscous friction, hard
+// stops at both ends and two limit switches with actuation offset, hysteresis and bounce.
+// Everything is reflected to the motor shaft, positions in the parameters and reports are
+// microsteps of grid travel, 0 is the home switch trip point, FORWARD is positive.
+// The state is integrated with a fixed step up to every machine event and parked while
+// the mechanics are at rest, so an idle board costs nothing.
+namespace sim{
+
+class Plant : public Machine::Model{
+public:
+    enum class Switch : uint8_t{
+        home,
+        in_field,
+        count
+    };
+
+    static constexpr std::size_t kSwitchCount = static_cast<std::size_t>(Switch::count);
+
+    struct Params{
+        double holding_torque {0.45};       // N m
+        double corner_speed {250};          // rad/s, pull-out torque is halved here
+        double rotor_inertia {6.8e-6};      // kg m^2
+        double rotor_damping {2e-4};        // N m s/rad
+        double grid_inertia {2e-5};         // kg m^2, at the motor shaft
+        double drive_stiffness {40};        // N m/rad
+        double drive_damping {2e-3};        // N m s/rad
+        double coulomb_friction {0.02};     // N m
+        double viscous_friction {1e-4};     // N m s/rad
+        double field_edge {7680};           // in_field switch trip point
+        double switch_offset {0};           // actuation offset of both switches, towards the field
+        double switch_hysteresis {4};
+        double hard_stop_margin {160};      // free travel past each trip point
+        double bounce_us {300};
+        double bounce_count {3};            // contact reopenings per switch transition
+        double start_position {-16};
+        double seed {1};
+    };
+
+    struct SwitchPin{
+        GPIO_TypeDef* port;
+        uint16_t pin;
+        bool active_level;
+    };
+
+    struct Observer{
+        // settled switch state, bounce is only seen by the firmware
+        virtual void OnSwitch(Nanos, Switch, bool /*active*/, double /*position*/){}
+        // the rotor fell behind (negative) or ran ahead of the commanded position by whole
+        // electrical periods
+        virtual void OnSlip(Nanos, int32_t /*microsteps*/, double /*position*/){}
+    };
+
+    // 1.8 deg motor at $DriverMicroStep (app_config.hpp)
+    static constexpr uint32_t kFullStepsPerRev = 200;
+    static constexpr uint32_t kMicrosteps = 16;
+    static constexpr uint32_t kMicrostepsPerPeriod = 4 * kMicrosteps;
+
+    Plant(const Params& params, const std::array<SwitchPin, kSwitchCount>& pins);
+
+    // name=value into Params, false on an unknown name
+    static bool SetParam(Params& params, std::string_view assignment);
+    static void PrintParams(const Params& params);
+
+    void SetObserver(Observer* observer){ observer_ = observer; }
+    // rising step edge at t, integrates up to t first
+    void Step(Nanos t, bool forward);
+    void AdvanceTo(Nanos t) override;
+
+    [[nodiscard]] double Position() const;
+    [[nodiscard]] int64_t Commanded() const{ return commanded_; }
+    // microsteps lost or gained in pole slips
+    [[nodiscard]] int64_t Lost() const{ return lost_; }
+    [[nodiscard]] double MaxError() const{ return max_error_; }
+
+private:
+    static constexpr Nanos kDt = 5'000;
+    // parked after this long below kRestSpeed
+    static constexpr Nanos kRestTime = 2'000'000;
+    static constexpr double kRestSpeed = 1e-3;
+
+    struct SwitchState{
+        SwitchPin pin;
+        bool active {false};
+        // contact level changes after the last transition, on top of !active
+        std::vector<Nanos> bounces;
+        int8_t driven {-1};
+    };
+
+    void Integrate();
+    void UpdateSwitches();
+    void Transition(SwitchState& sw, Switch which, bool active);
+    void DriveInputs();
+    [[nodiscard]] double Random();
+
+    Params params_;
+    Observer* observer_ {nullptr};
+    std::array<SwitchState, kSwitchCount> switches_;
+    Nanos now_ {0};
+    Nanos quiet_since_ {0};
+    bool parked_ {false};
+    uint64_t rng_;
+
+    // shaft angles (rad) and speeds (rad/s)
+    double commanded_angle_;
+    double rotor_;
+    double rotor_speed_ {0};
+    double grid_;
+    double grid_speed_ {0};
+
+    int64_t commanded_ {0};
+    int64_t slip_periods_ {0};
+    int64_t lost_ {0};
+    double max_error_ {0};
+};
+
+}
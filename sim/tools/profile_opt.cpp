@@ -0,0 +1,378 @@
+// RasterDriverProfileOpt: sweeps the CONFIG*_MAX_SPEED, CONFIG*_ACCELERATION and
+// CONFIG*_RAMP_TIME parameters on the simulator and prints the Pareto front of
+// time exp_req -> in_motion (minimized) and time at constant velocity per oscillation sweep
+// (maximized), within step rate and jerk limits.
+// The firmware is a global singleton, so every candidate runs in its own RasterDriverSim
+// process, the candidate profile is written to the profile page of its flash image.
+// A pool of threads, one per core by default, keeps the processes going.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "motion_profiles.hpp"
+#include "trace_file.hpp"
+
+namespace{
+    constexpr uint32_t kProfilePageOffset = 0x1F000;   // _sprofiles - FLASH_BASE
+    constexpr uint32_t kFlashImageSize = 0x20000;
+    constexpr uint64_t kNanosPerMSec = 1'000'000;
+    // a step belongs to the cruise when its period is this close to the shortest one
+    constexpr double kCruiseTolerance = 0.01;
+    constexpr std::array<std::string_view, 4> kTypeNames{
+        "linear", "parabolic", "constant_power", "sigmoid",
+    };
+
+    struct Range{
+        double lo;
+        double hi;
+        uint32_t count;
+
+        [[nodiscard]] double At(uint32_t i) const{
+            return count > 1 ? lo + (hi - lo) * i / (count - 1) : lo;
+        }
+    };
+
+    // in the units of the app_config.hpp macros: $mSTEPS() and $rampT_() arguments
+    struct Candidate{
+        double vmax;
+        double accel;
+        double ramp_time;
+    };
+
+    struct Result{
+        Candidate candidate;
+        bool ran {false};
+        std::optional<double> in_motion_ms {};
+        double cruise_ms {0};
+        double max_rate {0};
+        double max_jerk {0};
+        bool feasible {false};
+        bool pareto {false};
+    };
+
+    struct Options{
+        std::string sim;
+        Range vmax {110, 190, 5};
+        Range accel {1.5, 4.5, 4};
+        Range ramp_time {2, 6, 3};
+        MotorSpecial::AccelType type {static_cast<MotorSpecial::AccelType>(ProfileTable::Defaults().profiles[0].accel_type)};
+        uint32_t slot {1};
+        double max_rate {PROFILE_MAX_SPEED};
+        double max_jerk {std::numeric_limits<double>::infinity()};
+        uint32_t jobs {std::max(1u, std::thread::hardware_concurrency())};
+        // grid in field, oscillation enabled, one exposure request
+        uint64_t request_ms {4000};
+        uint64_t release_ms {8000};
+        std::vector<std::string> scenario {
+            "0:config1=1", "0:config2=1", "0:config3=1", "0:exp_req=1", "0:home=1",
+            "1000:button=1", "1300:button=0", "1600:in_field=1", "1700:home=0",
+        };
+        const char* csv {nullptr};
+    };
+
+    MotionProfile MakeProfile(const Options& opt, const Candidate& c){
+        return {"opt", static_cast<uint32_t>(opt.type), $rampT_(c.ramp_time), static_cast<float>($mSTEPS(c.accel)),
+                static_cast<float>($mSTEPS(c.vmax)), static_cast<float>(INITIAL_SPEED)};
+    }
+
+    // the same profile in every slot, any DIP setting selects it
+    bool WriteFlashImage(const std::string& path, const MotionProfile& profile){
+        std::vector<char> image(kFlashImageSize, static_cast<char>(0xFF));
+        ProfileTable table;
+        table.count = ProfileTable::kMaxProfiles;
+        table.profiles.fill(profile);
+        table.crc = table.CalcCrc();
+        std::copy_n(reinterpret_cast<const char*>(&table), sizeof(table), image.begin() + kProfilePageOffset);
+        std::ofstream file{path, std::ios::binary};
+        file.write(image.data(), static_cast<std::streamsize>(image.size()));
+        return static_cast<bool>(file);
+    }
+
+    // shortest period, jerk and cruise time of every sweep between direction changes
+    void Evaluate(const char* trace_path, uint64_t from, uint64_t to, Result& result){
+        sim::MappedFile file{trace_path};
+        if(!file.IsOpen())
+            return;
+        std::vector<std::vector<StepTrace::Record>> sweeps;
+        auto decoder = file.Decoder();
+        StepTrace::Record record{};
+        while(decoder.Next(record)){
+            if(record.kind != StepTrace::Kind::step || record.time < from || record.time > to)
+                continue;
+            if(sweeps.empty() || sweeps.back().back().dir != record.dir)
+                sweeps.emplace_back();
+            sweeps.back().push_back(record);
+        }
+        double cruise_ns = 0;
+        uint32_t full_sweeps = 0;
+        for(std::size_t s = 0; s < sweeps.size(); s++){
+            auto& steps = sweeps[s];
+            if(steps.size() < 3)
+                continue;
+            std::vector<double> periods;
+            for(std::size_t i = 1; i < steps.size(); i++)
+                periods.push_back(static_cast<double>(steps[i].time - steps[i - 1].time));
+            auto shortest = *std::min_element(periods.begin(), periods.end());
+            result.max_rate = std::max(result.max_rate, 1e9 / shortest);
+            double prev_v = 0, prev_a = 0;
+            for(std::size_t i = 0; i < periods.size(); i++){
+                auto dt = periods[i] * 1e-9;
+                auto v = 1 / dt;
+                auto a = i ? (v - prev_v) / dt : 0;
+                if(i > 1)
+                    result.max_jerk = std::max(result.max_jerk, std::fabs(a - prev_a) / dt);
+                prev_v = v;
+                prev_a = a;
+            }
+            // the sweeps cut by the request and release edges are not full cycles
+            if(s == 0 || s + 1 == sweeps.size())
+                continue;
+            for(auto p : periods){
+                if(p <= shortest * (1 + kCruiseTolerance))
+                    cruise_ns += p;
+            }
+            full_sweeps++;
+        }
+        result.cruise_ms = full_sweeps ? cruise_ns / full_sweeps * 1e-6 : 0;
+    }
+
+    void Run(const Options& opt, const std::string& dir, std::size_t idx, Result& result){
+        auto base = dir + "/" + std::to_string(idx);
+        auto image = base + ".bin";
+        auto trace = base + ".rdst";
+        if(!WriteFlashImage(image, MakeProfile(opt, result.candidate)))
+            return;
+        auto cmd = opt.sim + " --ms " + std::to_string(opt.release_ms + 1000) + " --flash " + image
+                 + " --trace " + trace;
+        for(auto& set : opt.scenario)
+            cmd += " --set " + set;
+        cmd += " --set " + std::to_string(opt.request_ms) + ":exp_req=0";
+        cmd += " --set " + std::to_string(opt.release_ms) + ":exp_req=1";
+
+        auto request_ns = opt.request_ms * kNanosPerMSec;
+        auto release_ns = opt.release_ms * kNanosPerMSec;
+        auto out = popen(cmd.c_str(), "r");
+        if(!out)
+            return;
+        char line[256];
+        while(std::fgets(line, sizeof(line), out)){
+            unsigned long long t;
+            char name[32];
+            int level;
+            if(std::sscanf(line, "%llu pin %31s %d", &t, name, &level) != 3)
+                continue;
+            if(std::string_view{name} == "in_motion" && level && t >= request_ns && !result.in_motion_ms)
+                result.in_motion_ms = static_cast<double>(t - request_ns) * 1e-6;
+        }
+        result.ran = pclose(out) == 0;
+        Evaluate(trace.c_str(), request_ns, release_ns, result);
+        std::remove(image.c_str());
+        std::remove(trace.c_str());
+    }
+
+    void MarkPareto(std::vector<Result>& results){
+        for(auto& r : results){
+            if(!r.feasible)
+                continue;
+            r.pareto = std::none_of(results.begin(), results.end(), [&](const Result& o){
+                if(!o.feasible || &o == &r)
+                    return false;
+                bool no_worse = *o.in_motion_ms <= *r.in_motion_ms && o.cruise_ms >= r.cruise_ms;
+                bool better = *o.in_motion_ms < *r.in_motion_ms || o.cruise_ms > r.cruise_ms;
+                return no_worse && better;
+            });
+        }
+    }
+
+    // front point closest to the best in_motion and cruise times seen, both normalized
+    const Result* Knee(const std::vector<Result>& results){
+        double best_t = std::numeric_limits<double>::infinity(), worst_t = 0;
+        double best_c = 0, worst_c = std::numeric_limits<double>::infinity();
+        for(auto& r : results){
+            if(!r.pareto)
+                continue;
+            best_t = std::min(best_t, *r.in_motion_ms);
+            worst_t = std::max(worst_t, *r.in_motion_ms);
+            best_c = std::max(best_c, r.cruise_ms);
+            worst_c = std::min(worst_c, r.cruise_ms);
+        }
+        const Result* knee = nullptr;
+        double knee_dist = std::numeric_limits<double>::infinity();
+        for(auto& r : results){
+            if(!r.pareto)
+                continue;
+            auto dt = worst_t > best_t ? (*r.in_motion_ms - best_t) / (worst_t - best_t) : 0;
+            auto dc = best_c > worst_c ? (best_c - r.cruise_ms) / (best_c - worst_c) : 0;
+            if(std::hypot(dt, dc) < knee_dist){
+                knee_dist = std::hypot(dt, dc);
+                knee = &r;
+            }
+        }
+        return knee;
+    }
+
+    bool ParseRange(const char* arg, Range& range){
+        return std::sscanf(arg, "%lf:%lf:%u", &range.lo, &range.hi, &range.count) == 3 && range.count;
+    }
+
+    void Usage(const char* argv0){
+        std::fprintf(stderr,
+            "usage: %s [--sim <RasterDriverSim>] [--jobs <n>] [--slot <1|2>]\n"
+            "          [--type <linear|parabolic|constant_power|sigmoid>]\n"
+            "          [--vmax <lo:hi:n>] [--accel <lo:hi:n>] [--ramp-time <lo:hi:n>]\n"
+            "          [--max-rate <steps/s>] [--max-jerk <steps/s^3>]\n"
+            "          [--request <ms>] [--release <ms>] [--scenario <ms>:<pin>=<0|1>]... [--csv <file>]\n"
+            "  ranges are in $mSTEPS() / $rampT_() units as in app_config.hpp\n"
+            "  --scenario replaces the default one, see RasterDriverSim --set\n", argv0);
+        std::exit(2);
+    }
+
+    Options Parse(int argc, char** argv){
+        Options opt;
+        std::string self{argv[0]};
+        auto slash = self.rfind('/');
+        opt.sim = (slash == std::string::npos ? std::string{"."} : self.substr(0, slash)) + "/RasterDriverSim";
+        bool scenario_given = false;
+        for(int i = 1; i < argc; i++){
+            std::string_view arg{argv[i]};
+            if(i + 1 == argc)
+                Usage(argv[0]);
+            auto value = argv[++i];
+            if(arg == "--sim")
+                opt.sim = value;
+            else if(arg == "--jobs")
+                opt.jobs = std::max(1ul, std::strtoul(value, nullptr, 10));
+            else if(arg == "--type"){
+                auto type = std::find(kTypeNames.begin(), kTypeNames.end(), value);
+                if(type == kTypeNames.end())
+                    Usage(argv[0]);
+                opt.type = static_cast<MotorSpecial::AccelType>(type - kTypeNames.begin());
+            }
+            else if(arg == "--slot")
+                opt.slot = std::strtoul(value, nullptr, 10);
+            else if(arg == "--vmax" && ParseRange(value, opt.vmax))
+                continue;
+            else if(arg == "--accel" && ParseRange(value, opt.accel))
+                continue;
+            else if(arg == "--ramp-time" && ParseRange(value, opt.ramp_time))
+                continue;
+            else if(arg == "--max-rate")
+                opt.max_rate = std::strtod(value, nullptr);
+            else if(arg == "--max-jerk")
+                opt.max_jerk = std::strtod(value, nullptr);
+            else if(arg == "--request")
+                opt.request_ms = std::strtoull(value, nullptr, 10);
+            else if(arg == "--release")
+                opt.release_ms = std::strtoull(value, nullptr, 10);
+            else if(arg == "--scenario"){
+                if(!scenario_given)
+                    opt.scenario.clear();
+                scenario_given = true;
+                opt.scenario.emplace_back(value);
+            }else if(arg == "--csv")
+                opt.csv = value;
+            else
+                Usage(argv[0]);
+        }
+        if(opt.release_ms <= opt.request_ms)
+            Usage(argv[0]);
+        return opt;
+    }
+}
+
+extern "C" void Error_Handler(void){
+    std::fprintf(stderr, "profile_opt: Error_Handler\n");
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv){
+    auto opt = Parse(argc, argv);
+
+    std::vector<Result> results;
+    for(uint32_t v = 0; v < opt.vmax.count; v++){
+        for(uint32_t a = 0; a < opt.accel.count; a++){
+            for(uint32_t r = 0; r < opt.ramp_time.count; r++){
+                Candidate c{opt.vmax.At(v), opt.accel.At(a), opt.ramp_time.At(r)};
+                if(MakeProfile(opt, c).IsValid())
+                    results.push_back({c});
+            }
+        }
+    }
+
+    char dir_template[] = "/tmp/profile_opt.XXXXXX";
+    if(!mkdtemp(dir_template)){
+        std::fprintf(stderr, "profile_opt: cannot create a work directory\n");
+        return EXIT_FAILURE;
+    }
+    std::string dir{dir_template};
+    std::fprintf(stderr, "profile_opt: %zu candidates on %u threads\n", results.size(), opt.jobs);
+
+    std::atomic<std::size_t> next{0};
+    std::vector<std::thread> pool;
+    for(uint32_t i = 0; i < opt.jobs; i++){
+        pool.emplace_back([&]{
+            for(auto idx = next++; idx < results.size(); idx = next++)
+                Run(opt, dir, idx, results[idx]);
+        });
+    }
+    for(auto& thread : pool)
+        thread.join();
+    rmdir(dir.c_str());
+
+    for(auto& r : results){
+        r.feasible = r.ran && r.in_motion_ms && r.max_rate <= opt.max_rate && r.max_jerk <= opt.max_jerk;
+    }
+    MarkPareto(results);
+
+    if(opt.csv){
+        if(auto file = std::fopen(opt.csv, "w")){
+            std::fprintf(file, "vmax,accel,ramp_time,in_motion_ms,cruise_ms,max_rate,max_jerk,feasible,pareto\n");
+            for(auto& r : results){
+                std::fprintf(file, "%g,%g,%g,%.3f,%.3f,%.1f,%.1f,%d,%d\n", r.candidate.vmax, r.candidate.accel,
+                             r.candidate.ramp_time, r.in_motion_ms.value_or(-1), r.cruise_ms, r.max_rate,
+                             r.max_jerk, r.feasible, r.pareto);
+            }
+            std::fclose(file);
+        }
+    }
+
+    std::vector<const Result*> front;
+    for(auto& r : results){
+        if(r.pareto)
+            front.push_back(&r);
+    }
+    std::sort(front.begin(), front.end(), [](auto a, auto b){ return *a->in_motion_ms < *b->in_motion_ms; });
+    std::printf("%8s %8s %9s %14s %14s %12s %14s\n", "vmax", "accel", "ramp_time", "in_motion ms",
+                "cruise ms", "max rate", "max jerk");
+    for(auto r : front){
+        std::printf("%8g %8g %9g %14.3f %14.3f %12.1f %14.1f\n", r->candidate.vmax, r->candidate.accel,
+                    r->candidate.ramp_time, *r->in_motion_ms, r->cruise_ms, r->max_rate, r->max_jerk);
+    }
+
+    auto knee = Knee(results);
+    if(!knee){
+        std::printf("no feasible candidate\n");
+        return EXIT_FAILURE;
+    }
+    auto profile = MakeProfile(opt, knee->candidate);
+    std::printf("\n// app_config.hpp, in_motion after %.3f ms, %.3f ms cruise per sweep\n",
+                *knee->in_motion_ms, knee->cruise_ms);
+    std::printf("#define CONFIG%u_MAX_SPEED                   $mSTEPS(%g)\n", opt.slot, knee->candidate.vmax);
+    std::printf("#define CONFIG%u_RAMP_TIME                   $rampT_(%g)\n", opt.slot, knee->candidate.ramp_time);
+    std::printf("#define CONFIG%u_ACCELERATION                $mSTEPS(%g)\n", opt.slot, knee->candidate.accel);
+    std::printf("// ProfileTable entry\n{\"opt\", %u, %g, %g, %g, %g}\n", profile.accel_type,
+                profile.ramp_time, profile.A, profile.Vmax, profile.Vmin);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+// RasterDriverProfileReport: compares the velocity profiles of every AccelType on both DIP
+// speed sets. Each combination runs the firmware AccelMotor on the sim board model twice:
+// an edge to edge move of STEPS_BEFORE_DECCEL and one oscillation leg of EXPO_RANGE_STEPS,
+// the step intervals are the auto reload values programmed into the step timer (TIM4).
+// Prints a summary table, --csv writes every step of both moves in long format for
+// plotting, --summary the table as CSV. The numbers are only as good as the AccelMotor
+// built in: when every AccelType steps a speed set identically, the motor library does not
+// implement the types and the report says so and fails.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tim.h"
+#include "refresh_bench.hpp"
+
+namespace{
+    constexpr std::array<std::string_view, RefreshBench::kTypeCount> kTypeNames{
+        "linear", "parabolic", "constant_power", "sigmoid",
+    };
+    constexpr std::array<std::string_view, RefreshBench::kSpeedSets.size()> kSetNames{"cfg1", "cfg2"};
+
+    enum class Move : uint8_t{
+        edge_to_edge,
+        expo_leg,
+        count
+    };
+    constexpr std::array<std::string_view, utils::get_idx(Move::count)> kMoveNames{"edge_to_edge", "expo_leg"};
+
+    struct Options{
+        uint32_t steps {RefreshBench::kMoveSteps};
+        uint32_t expo_steps {EXPO_RANGE_STEPS};
+        const char* csv {nullptr};
+        const char* summary {nullptr};
+    };
+
+    struct Interval{
+        uint32_t ticks;
+        RefreshBench::Phase phase;
+    };
+
+    struct Summary{
+        std::size_t type;
+        std::size_t set;
+        float vmax;
+        // ProfileTable::Defaults entries (DIP configs) running this combination, -1 for none
+        int dip {-1};
+        double time_to_vmax_ms {0};
+        uint32_t steps_to_vmax {0};
+        double expo_avg_speed {0};
+        double peak_accel {0};
+        // distinct step periods of the ramp, the length of a table replacing it
+        std::size_t distinct_periods {0};
+    };
+
+    // motor timer tick of the firmware, TIM4 prescaler from CubeMX
+    uint64_t TickNs(){
+        return (static_cast<uint64_t>(htim4.Init.Prescaler) + 1) * 1'000'000'000 / SystemCoreClock;
+    }
+
+    double Seconds(uint32_t ticks){
+        return static_cast<double>(ticks) * static_cast<double>(TickNs()) * 1e-9;
+    }
+
+    // the interval programmed by MakeMotorTask() and after each MotorRefresh(), whole move
+    std::vector<Interval> Generate(MotorSpecial::AccelCfg cfg, uint32_t steps){
+        cfg.stepper_cfg.htim = &htim4;
+        cfg.stepper_cfg.channel = TIM_CHANNEL_2;
+        RefreshBench::Motor motor{cfg};
+        std::vector<Interval> intervals;
+        motor.Start(steps);
+        for(uint32_t step = 0; step < steps && motor.IsMotorMoving(); step++){
+            intervals.push_back({htim4.Instance->ARR + 1, motor.CurrentPhase()});
+            motor.MotorRefresh();
+        }
+        motor.StopMotor();
+        return intervals;
+    }
+
+    int DipConfig(const MotorSpecial::AccelCfg& cfg){
+        auto defaults = ProfileTable::Defaults();
+        for(uint8_t idx = 0; idx < defaults.count; idx++){
+            auto& p = defaults.profiles[idx];
+            if(p.accel_type == utils::get_idx(cfg.accel_type) && p.Vmax == cfg.Vmax && p.Vmin == cfg.Vmin
+               && p.A == cfg.A && p.ramp_time == cfg.ramp_time)
+                return idx;
+        }
+        return -1;
+    }
+
+    void Measure(Summary& s, const std::vector<Interval>& ramp, const std::vector<Interval>& expo){
+        std::set<uint32_t> periods;
+        double prev_v = 0;
+        for(std::size_t i = 0; i < ramp.size(); i++){
+            auto period = Seconds(ramp[i].ticks);
+            auto v = 1 / period;
+            if(i)
+                s.peak_accel = std::max(s.peak_accel, std::fabs(v - prev_v) / period);
+            prev_v = v;
+            if(ramp[i].phase != RefreshBench::Phase::accel)
+                continue;
+            s.steps_to_vmax++;
+            s.time_to_vmax_ms += period * 1e3;
+            periods.insert(ramp[i].ticks);
+        }
+        s.distinct_periods = periods.size();
+
+        double expo_time = 0;
+        for(auto& interval : expo)
+            expo_time += Seconds(interval.ticks);
+        s.expo_avg_speed = expo_time > 0 ? static_cast<double>(expo.size()) / expo_time : 0;
+    }
+
+    bool WriteSteps(std::FILE* file, const Summary& s, Move move, const std::vector<Interval>& intervals){
+        double time = 0;
+        for(std::size_t i = 0; i < intervals.size(); i++){
+            auto period = Seconds(intervals[i].ticks);
+            time += period;
+            std::fprintf(file, "%s,%s,%s,%zu,%u,%u,%.0f,%.3f\n",
+                         kTypeNames[s.type].data(), kSetNames[s.set].data(), kMoveNames[utils::get_idx(move)].data(),
+                         i, static_cast<unsigned>(intervals[i].phase), intervals[i].ticks, time * 1e9, 1 / period);
+        }
+        return !std::ferror(file);
+    }
+
+    bool WriteSummary(const char* path, const std::vector<Summary>& rows){
+        auto file = std::fopen(path, "w");
+        if(!file)
+            return false;
+        std::fprintf(file, "type,set,dip,vmax,time_to_vmax_ms,steps_to_vmax,expo_avg_speed,expo_avg_ratio,"
+                           "peak_accel,distinct_periods\n");
+        for(auto& s : rows)
+            std::fprintf(file, "%s,%s,%d,%.1f,%.3f,%u,%.1f,%.3f,%.0f,%zu\n",
+                         kTypeNames[s.type].data(), kSetNames[s.set].data(), s.dip, s.vmax, s.time_to_vmax_ms,
+                         s.steps_to_vmax, s.expo_avg_speed, s.expo_avg_speed / s.vmax, s.peak_accel, s.distinct_periods);
+        return std::fclose(file) == 0;
+    }
+
+    bool SameTicks(const std::vector<Interval>& a, const std::vector<Interval>& b){
+        return a.size() == b.size()
+            && std::equal(a.begin(), a.end(), b.begin(), [](auto& x, auto& y){ return x.ticks == y.ticks; });
+    }
+
+    void PrintTable(const Options& opt, const std::vector<Summary>& rows){
+        std::printf("edge to edge move %u steps, expo leg %u steps, speeds in steps/s\n\n", opt.steps, opt.expo_steps);
+        std::printf("%-15s %-4s %3s %7s %12s %10s %10s %6s %12s %8s\n",
+                    "type", "set", "dip", "Vmax", "to Vmax ms", "to Vmax st", "expo avg", "/Vmax",
+                    "peak dv/dt", "periods");
+        for(auto& s : rows){
+            auto dip = s.dip < 0 ? std::string{"-"} : std::to_string(s.dip);
+            std::printf("%-15s %-4s %3s %7.1f %12.3f %10u %10.1f %6.3f %12.0f %8zu\n",
+                        kTypeNames[s.type].data(), kSetNames[s.set].data(), dip.c_str(), s.vmax, s.time_to_vmax_ms,
+                        s.steps_to_vmax, s.expo_avg_speed, s.expo_avg_speed / s.vmax, s.peak_accel, s.distinct_periods);
+        }
+    }
+
+    void Usage(const char* argv0){
+        std::fprintf(stderr,
+            "usage: %s [--steps <n>] [--expo-steps <n>] [--csv <file>] [--summary <file>]\n"
+            "  --steps       edge to edge move, default STEPS_BEFORE_DECCEL\n"
+            "  --expo-steps  oscillation leg, default EXPO_RANGE_STEPS\n"
+            "  --csv         type,set,move,step,phase,ticks,time_ns,speed for every step\n"
+            "  --summary     the summary table as CSV\n", argv0);
+        std::exit(2);
+    }
+
+    Options Parse(int argc, char** argv){
+        Options opt;
+        for(int i = 1; i < argc; i++){
+            std::string_view arg{argv[i]};
+            if(i + 1 == argc)
+                Usage(argv[0]);
+            auto value = argv[++i];
+            if(arg == "--steps")
+                opt.steps = std::strtoul(value, nullptr, 10);
+            else if(arg == "--expo-steps")
+                opt.expo_steps = std::strtoul(value, nullptr, 10);
+            else if(arg == "--csv")
+                opt.csv = value;
+            else if(arg == "--summary")
+                opt.summary = value;
+            else
+                Usage(argv[0]);
+        }
+        if(!opt.steps || !opt.expo_steps)
+            Usage(argv[0]);
+        return opt;
+    }
+}
+
+extern "C" void Error_Handler(void){
+    std::fprintf(stderr, "profile_report: Error_Handler\n");
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv){
+    auto opt = Parse(argc, argv);
+    MX_TIM4_Init();
+
+    std::FILE* csv = nullptr;
+    if(opt.csv){
+        csv = std::fopen(opt.csv, "w");
+        if(!csv){
+            std::fprintf(stderr, "profile_report: cannot write %s\n", opt.csv);
+            return EXIT_FAILURE;
+        }
+        std::fprintf(csv, "type,set,move,step,phase,ticks,time_ns,speed\n");
+    }
+
+    std::vector<Summary> rows;
+    // ramp of the first type per speed set, and whether every other type matched it
+    std::array<std::vector<Interval>, RefreshBench::kSpeedSets.size()> first_ramps;
+    std::array<bool, RefreshBench::kSpeedSets.size()> types_identical;
+    types_identical.fill(true);
+    for(std::size_t type = 0; type < RefreshBench::kTypeCount; type++){
+        for(std::size_t set = 0; set < RefreshBench::kSpeedSets.size(); set++){
+            auto cfg = RefreshBench::Config(static_cast<MotorSpecial::AccelType>(type), set);
+            Summary s{type, set, cfg.Vmax, DipConfig(cfg)};
+            auto ramp = Generate(cfg, opt.steps);
+            auto expo = Generate(cfg, opt.expo_steps);
+            Measure(s, ramp, expo);
+            if(!type)
+                first_ramps[set] = ramp;
+            else if(!SameTicks(ramp, first_ramps[set]))
+                types_identical[set] = false;
+            rows.push_back(s);
+            if(csv && !(WriteSteps(csv, s, Move::edge_to_edge, ramp) && WriteSteps(csv, s, Move::expo_leg, expo))){
+                std::fprintf(stderr, "profile_report: cannot write %s\n", opt.csv);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    PrintTable(opt, rows);
+    bool valid = true;
+    for(std::size_t set = 0; set < RefreshBench::kSpeedSets.size(); set++){
+        if(!types_identical[set])
+            continue;
+        std::printf("\nINVALID: every AccelType steps %s identically, the AccelMotor built in ignores accel_type.\n"
+                    "The rows above do not compare the types, rebuild against the embedded_hw_utils submodule.\n",
+                    kSetNames[set].data());
+        valid = false;
+    }
+    if(csv && std::fclose(csv) != 0){
+        std::fprintf(stderr, "profile_report: cannot write %s\n", opt.csv);
+        return EXIT_FAILURE;
+    }
+    if(opt.summary && !WriteSummary(opt.summary, rows)){
+        std::fprintf(stderr, "profile_report: cannot write %s\n", opt.summary);
+        return EXIT_FAILURE;
+    }
+    if(!valid){
+        std::fprintf(stderr, "profile_report: results invalid, the AccelTypes are not distinguished\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,325 @@
+// RasterDriverRampGen: step interval tables of AccelMotor for an AccelCfg, taken from the
+// auto reload values the firmware code programs into the step timer (TIM4) while it runs a
+// move on the sim board model. Writes a constexpr header, CSV and a step trace, prints the
+// ramp metrics. --check compares a previously generated header byte for byte, --check-trace
+// the acceleration phase with the first oscillation leg the whole firmware stepped in a
+// RasterDriverSim trace (TIM4 PWM and step ISR), which must run the same profile.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tim.h"
+#include "refresh_bench.hpp"
+#include "trace_file.hpp"
+
+namespace{
+    constexpr std::array<std::string_view, RefreshBench::kTypeCount> kTypeNames{
+        "linear", "parabolic", "constant_power", "sigmoid",
+    };
+    constexpr std::array<std::string_view, RefreshBench::kTypeCount> kTypeIdents{
+        "Linear", "Parabolic", "ConstantPower", "Sigmoid",
+    };
+
+    struct Options{
+        MotorSpecial::AccelCfg cfg {ProfileTable::Defaults().profiles[0].MakeAppConfig().accelCfg};
+        std::string name {};
+        uint32_t steps {RefreshBench::kMoveSteps};
+        bool full {false};
+        const char* header {nullptr};
+        const char* csv {nullptr};
+        const char* trace {nullptr};
+        const char* check {nullptr};
+        const char* check_trace {nullptr};
+        std::string command {};
+    };
+
+    struct Interval{
+        uint32_t ticks;
+        RefreshBench::Phase phase;
+    };
+
+    struct Metrics{
+        uint32_t ramp_steps {0};
+        uint64_t ramp_time_ns {0};
+        double peak_accel {0};
+    };
+
+    // motor timer tick of the firmware, TIM4 prescaler from CubeMX
+    uint64_t TickNs(){
+        return (static_cast<uint64_t>(htim4.Init.Prescaler) + 1) * 1'000'000'000 / SystemCoreClock;
+    }
+
+    uint32_t Ticks(){
+        return htim4.Instance->ARR + 1;
+    }
+
+    // the interval programmed by MakeMotorTask() and after each MotorRefresh()
+    std::vector<Interval> Generate(const Options& opt){
+        auto cfg = opt.cfg;
+        cfg.stepper_cfg.htim = &htim4;
+        cfg.stepper_cfg.channel = TIM_CHANNEL_2;
+        RefreshBench::Motor motor{cfg};
+        std::vector<Interval> intervals;
+        motor.Start();
+        for(uint32_t step = 0; step < opt.steps && motor.IsMotorMoving(); step++){
+            auto phase = motor.CurrentPhase();
+            if(!opt.full && phase != RefreshBench::Phase::accel)
+                break;
+            intervals.push_back({Ticks(), phase});
+            motor.MotorRefresh();
+        }
+        motor.StopMotor();
+        return intervals;
+    }
+
+    Metrics Measure(const std::vector<Interval>& intervals){
+        Metrics m;
+        auto tick = static_cast<double>(TickNs()) * 1e-9;
+        double prev_v = 0;
+        for(std::size_t i = 0; i < intervals.size(); i++){
+            auto period = intervals[i].ticks * tick;
+            auto v = 1 / period;
+            if(i)
+                m.peak_accel = std::max(m.peak_accel, (v - prev_v) / period);
+            prev_v = v;
+            if(intervals[i].phase == RefreshBench::Phase::accel){
+                m.ramp_steps++;
+                m.ramp_time_ns += intervals[i].ticks * TickNs();
+            }
+        }
+        return m;
+    }
+
+    std::string Header(const Options& opt, const std::vector<Interval>& intervals, const Metrics& m){
+        std::ostringstream out;
+        out << "// Generated by " << opt.command << "\n"
+            << "// do not edit, regenerate with RasterDriverRampGen\n"
+            << "#pragma once\n\n#include <array>\n#include <cstdint>\n\n"
+            << "namespace ramp_tables{\n"
+            << "// " << kTypeNames[utils::get_idx(opt.cfg.accel_type)]
+            << ", Vmin " << opt.cfg.Vmin << ", Vmax " << opt.cfg.Vmax << ", A " << opt.cfg.A
+            << ", ramp_time " << opt.cfg.ramp_time << "\n"
+            << "// " << m.ramp_steps << " steps to Vmax in " << m.ramp_time_ns << " ns, peak acceleration "
+            << static_cast<uint64_t>(m.peak_accel) << " steps/s^2\n"
+            << "inline constexpr uint32_t " << opt.name << "TickNs = " << TickNs() << ";\n"
+            << "inline constexpr std::array<uint32_t, " << intervals.size() << "> " << opt.name << "{";
+        for(std::size_t i = 0; i < intervals.size(); i++)
+            out << (i % 12 ? " " : "\n    ") << intervals[i].ticks << ",";
+        out << "\n};\n}\n";
+        return out.str();
+    }
+
+    bool WriteCsv(const char* path, const std::vector<Interval>& intervals){
+        auto file = std::fopen(path, "w");
+        if(!file)
+            return false;
+        std::fprintf(file, "step,phase,ticks,time_ns,speed\n");
+        uint64_t time = 0;
+        auto tick = TickNs();
+        for(std::size_t i = 0; i < intervals.size(); i++){
+            time += intervals[i].ticks * tick;
+            std::fprintf(file, "%zu,%u,%u,%llu,%.3f\n", i, static_cast<unsigned>(intervals[i].phase),
+                         intervals[i].ticks, static_cast<unsigned long long>(time),
+                         1e9 / static_cast<double>(intervals[i].ticks * tick));
+        }
+        return std::fclose(file) == 0;
+    }
+
+    // intervals between the steps of the first oscillation leg: from the first step after the
+    // state event entering RBTypes::State::oscillation to the next direction or state change
+    std::optional<std::vector<uint64_t>> OscillationLeg(const char* path){
+        sim::MappedFile file{path};
+        if(!file.IsOpen())
+            return std::nullopt;
+        auto decoder = file.Decoder();
+        StepTrace::Record record{};
+        bool started = false;
+        std::optional<StepTrace::Record> last;
+        std::vector<uint64_t> intervals;
+        while(decoder.Next(record)){
+            if(record.kind == StepTrace::Kind::state){
+                if(last)
+                    break;
+                started = record.index == utils::get_idx(RBTypes::State::oscillation);
+                continue;
+            }
+            if(!started || record.kind != StepTrace::Kind::step)
+                continue;
+            if(last && record.dir != last->dir)
+                break;
+            if(last)
+                intervals.push_back(record.time - last->time);
+            last = record;
+        }
+        if(!decoder.IsValid() || intervals.empty())
+            return std::nullopt;
+        return intervals;
+    }
+
+    bool CheckTrace(const char* path, const std::vector<Interval>& intervals){
+        auto leg = OscillationLeg(path);
+        if(!leg){
+            std::fprintf(stderr, "ramp_gen: no oscillation leg in %s\n", path);
+            return false;
+        }
+        std::size_t ramp = 0;
+        for(; ramp < intervals.size() && intervals[ramp].phase == RefreshBench::Phase::accel; ramp++){
+            if(ramp == leg->size()){
+                std::fprintf(stderr, "ramp_gen: oscillation leg in %s ends after %zu of %zu ramp steps\n",
+                             path, ramp, intervals.size());
+                return false;
+            }
+            auto expected = intervals[ramp].ticks * TickNs();
+            if((*leg)[ramp] != expected){
+                std::fprintf(stderr, "ramp_gen: step %zu of the oscillation leg in %s is %llu ns, generated %llu ns\n",
+                             ramp, path, static_cast<unsigned long long>((*leg)[ramp]),
+                             static_cast<unsigned long long>(expected));
+                return false;
+            }
+        }
+        std::printf("  %s oscillation leg matches %zu ramp steps\n", path, ramp);
+        return true;
+    }
+
+    void WriteTrace(const char* path, const std::vector<Interval>& intervals){
+        sim::StepTraceFile trace;
+        if(!trace.Open(path, 0))
+            return;
+        uint64_t time = 0;
+        for(auto& interval : intervals){
+            time += interval.ticks * TickNs();
+            trace.Step(time, true);
+        }
+    }
+
+    void Usage(const char* argv0){
+        std::fprintf(stderr,
+            "usage: %s [--profile <0..3>] [--type <linear|parabolic|constant_power|sigmoid>]\n"
+            "          [--vmin <steps/s>] [--vmax <steps/s>] [--accel <A>] [--ramp-time <t>]\n"
+            "          [--steps <n>] [--full] [--name <identifier>]\n"
+            "          [--header <file>] [--csv <file>] [--trace <file>] [--check <header>]\n"
+            "          [--check-trace <RasterDriverSim trace>]\n"
+            "  --profile  start from a ProfileTable::Defaults entry (DIP config), default 0\n"
+            "  --full     whole move instead of the acceleration phase only\n"
+            "  --check-trace  the ramp must match the first oscillation leg stepped by the firmware\n", argv0);
+        std::exit(2);
+    }
+
+    Options Parse(int argc, char** argv){
+        Options opt;
+        std::vector<std::string_view> args{argv + 1, argv + argc};
+        // profile first, the other options override its fields
+        for(std::size_t i = 0; i + 1 < args.size(); i++){
+            if(args[i] != "--profile")
+                continue;
+            auto idx = std::strtoul(args[i + 1].data(), nullptr, 10);
+            if(idx >= ProfileTable::Defaults().count)
+                Usage(argv[0]);
+            opt.cfg = ProfileTable::Defaults().profiles[idx].MakeAppConfig().accelCfg;
+        }
+        opt.command = "RasterDriverRampGen";
+        for(std::size_t i = 0; i < args.size(); i++){
+            auto arg = args[i];
+            if(arg == "--full"){
+                opt.full = true;
+                opt.command += " --full";
+                continue;
+            }
+            if(i + 1 == args.size())
+                Usage(argv[0]);
+            auto value = argv[i + 2];
+            i++;
+            if(arg != "--header" && arg != "--csv" && arg != "--trace" && arg != "--check" && arg != "--check-trace")
+                opt.command += std::string{" "} + std::string{arg} + " " + value;
+            if(arg == "--profile")
+                continue;
+            else if(arg == "--type"){
+                auto type = std::find(kTypeNames.begin(), kTypeNames.end(), value);
+                if(type == kTypeNames.end())
+                    Usage(argv[0]);
+                opt.cfg.accel_type = static_cast<MotorSpecial::AccelType>(type - kTypeNames.begin());
+            }else if(arg == "--vmin")
+                opt.cfg.Vmin = std::strtof(value, nullptr);
+            else if(arg == "--vmax")
+                opt.cfg.Vmax = std::strtof(value, nullptr);
+            else if(arg == "--accel")
+                opt.cfg.A = std::strtof(value, nullptr);
+            else if(arg == "--ramp-time")
+                opt.cfg.ramp_time = std::strtof(value, nullptr);
+            else if(arg == "--steps")
+                opt.steps = std::strtoul(value, nullptr, 10);
+            else if(arg == "--name")
+                opt.name = value;
+            else if(arg == "--header")
+                opt.header = value;
+            else if(arg == "--csv")
+                opt.csv = value;
+            else if(arg == "--trace")
+                opt.trace = value;
+            else if(arg == "--check")
+                opt.check = value;
+            else if(arg == "--check-trace")
+                opt.check_trace = value;
+            else
+                Usage(argv[0]);
+        }
+        if(opt.name.empty())
+            opt.name = "k" + std::string{kTypeIdents[utils::get_idx(opt.cfg.accel_type)]} + "Ramp";
+        return opt;
+    }
+}
+
+extern "C" void Error_Handler(void){
+    std::fprintf(stderr, "ramp_gen: Error_Handler\n");
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv){
+    auto opt = Parse(argc, argv);
+    MX_TIM4_Init();
+
+    auto intervals = Generate(opt);
+    auto metrics = Measure(intervals);
+    auto header = Header(opt, intervals, metrics);
+
+    std::printf("%s: %s Vmin %g Vmax %g A %g ramp_time %g\n", opt.name.c_str(),
+                std::string{kTypeNames[utils::get_idx(opt.cfg.accel_type)]}.c_str(),
+                opt.cfg.Vmin, opt.cfg.Vmax, opt.cfg.A, opt.cfg.ramp_time);
+    std::printf("  steps in ramp     %u\n", metrics.ramp_steps);
+    std::printf("  time to Vmax      %.3f ms\n", static_cast<double>(metrics.ramp_time_ns) * 1e-6);
+    std::printf("  peak acceleration %.1f steps/s^2\n", metrics.peak_accel);
+
+    if(opt.check){
+        std::ifstream file{opt.check, std::ios::binary};
+        std::string stored{std::istreambuf_iterator<char>{file}, {}};
+        if(!file.is_open() || stored != header){
+            std::fprintf(stderr, "ramp_gen: %s does not match the firmware AccelMotor\n", opt.check);
+            return EXIT_FAILURE;
+        }
+        std::printf("  %s matches\n", opt.check);
+    }
+    if(opt.check_trace && !CheckTrace(opt.check_trace, intervals))
+        return EXIT_FAILURE;
+    if(opt.header){
+        std::ofstream file{opt.header, std::ios::binary};
+        file << header;
+        if(!file){
+            std::fprintf(stderr, "ramp_gen: cannot write %s\n", opt.header);
+            return EXIT_FAILURE;
+        }
+    }
+    if(opt.csv && !WriteCsv(opt.csv, intervals)){
+        std::fprintf(stderr, "ramp_gen: cannot write %s\n", opt.csv);
+        return EXIT_FAILURE;
+    }
+    if(opt.trace)
+        WriteTrace(opt.trace, intervals);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+// RasterDriverSimBench: end to end throughput of RasterDriverSim on a fixed scenario.
+// Boot, homing and calibration with the plant model, then 1000 oscillating exposures of
+// pseudo random length with a service move home and back every 100 exposures. Reports
+// simulated steps and events per wall clock second, best of --repeat runs. --csv appends
+// the result to a history file, --max-slowdown fails when steps/s dropped by more than
+// that fraction against the last row already in it, a negative fraction only reports.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace{
+    constexpr uint32_t kExposures = 1000;
+    constexpr uint32_t kServiceEvery = 100;
+    // grid in field and oscillation selected, see the DIP mapping in app_config.hpp
+    constexpr uint64_t kFirstExposureMs = 20'000;
+    constexpr uint64_t kServiceMoveMs = 10'000;
+    constexpr uint64_t kButtonHoldMs = 300;
+
+    struct Options{
+        std::string sim;
+        uint32_t repeat {3};
+        const char* csv {nullptr};
+        const char* label {nullptr};
+        double max_slowdown {-1};
+    };
+
+    struct Result{
+        double simulated_s {0};
+        double wall_s {0};
+        uint64_t steps {0};
+        uint64_t events {0};
+
+        [[nodiscard]] double StepsPerSec() const{ return static_cast<double>(steps) / wall_s; }
+        [[nodiscard]] double EventsPerSec() const{ return static_cast<double>(events) / wall_s; }
+        [[nodiscard]] double RealTime() const{ return simulated_s / wall_s; }
+    };
+
+    struct Scenario{
+        std::vector<std::string> args;
+        uint64_t end_ms {0};
+    };
+
+    void Set(Scenario& s, uint64_t ms, const char* pin, bool level){
+        s.args.push_back("--set " + std::to_string(ms) + ":" + pin + "=" + (level ? "1" : "0"));
+    }
+
+    void PressButton(Scenario& s, uint64_t ms){
+        Set(s, ms, "button", true);
+        Set(s, ms + kButtonHoldMs, "button", false);
+    }
+
+    // fixed seed, the scenario is the same on every run and every commit
+    Scenario MakeScenario(){
+        Scenario s;
+        s.args.emplace_back("--plant");
+        Set(s, 0, "config1", true);
+        Set(s, 0, "config2", true);
+        Set(s, 0, "config3", true);
+        Set(s, 0, "exp_req", true);
+        PressButton(s, kFirstExposureMs - kServiceMoveMs);
+
+        uint32_t rng = 12345;
+        auto next = [&rng](uint32_t lo, uint32_t hi){
+            rng = rng * 1664525u + 1013904223u;
+            return lo + (rng >> 8) % (hi - lo + 1);
+        };
+        auto t = kFirstExposureMs;
+        for(uint32_t i = 0; i < kExposures; i++){
+            if(i && i % kServiceEvery == 0){
+                PressButton(s, t);
+                PressButton(s, t + kServiceMoveMs);
+                t += 2 * kServiceMoveMs;
+            }
+            // exp_req is active low: from single short shots to long fluoroscopy runs
+            auto length = next(5, 1500);
+            Set(s, t, "exp_req", false);
+            Set(s, t + length, "exp_req", true);
+            t += length + next(100, 800);
+        }
+        s.end_ms = t + 1000;
+        return s;
+    }
+
+    bool Run(const Options& opt, const Scenario& scenario, Result& result){
+        auto cmd = opt.sim + " --stats --ms " + std::to_string(scenario.end_ms);
+        for(auto& arg : scenario.args)
+            cmd += " " + arg;
+        cmd += " 2>&1";
+        auto out = popen(cmd.c_str(), "r");
+        if(!out)
+            return false;
+        char line[512];
+        bool stats = false;
+        while(std::fgets(line, sizeof(line), out)){
+            unsigned long long t, steps, events;
+            long long position;
+            double simulated, wall, realtime;
+            if(std::sscanf(line, "%llu end steps %llu position %lld", &t, &steps, &position) == 3)
+                result.steps = steps;
+            else if(std::sscanf(line, "sim: %lf s simulated in %lf s wall, %lfx real time, %llu events",
+                                &simulated, &wall, &realtime, &events) == 4){
+                result.simulated_s = simulated;
+                result.wall_s = std::max(wall, 1e-9);
+                result.events = events;
+                stats = true;
+            }
+        }
+        return pclose(out) == 0 && stats;
+    }
+
+    // steps_per_s of the last row, the column order is the one AppendCsv() writes
+    bool LastStepsPerSec(const char* path, double& steps_per_s){
+        auto file = std::fopen(path, "r");
+        if(!file)
+            return false;
+        char line[512];
+        bool found = false;
+        while(std::fgets(line, sizeof(line), file)){
+            std::string_view row{line};
+            if(row.starts_with("time,"))
+                continue;
+            // time,label,simulated_s,wall_s,steps,events,steps_per_s,...
+            std::size_t pos = 0;
+            for(int column = 0; column < 6 && pos != std::string_view::npos; column++)
+                pos = row.find(',', pos + (column ? 1 : 0));
+            if(pos == std::string_view::npos)
+                continue;
+            steps_per_s = std::strtod(line + pos + 1, nullptr);
+            found = true;
+        }
+        std::fclose(file);
+        return found;
+    }
+
+    bool AppendCsv(const char* path, const char* label, const Result& r){
+        auto exists = std::fopen(path, "r");
+        if(exists)
+            std::fclose(exists);
+        auto file = std::fopen(path, "a");
+        if(!file)
+            return false;
+        if(!exists)
+            std::fprintf(file, "time,label,simulated_s,wall_s,steps,events,steps_per_s,events_per_s,real_time\n");
+        std::fprintf(file, "%lld,%s,%.3f,%.4f,%llu,%llu,%.0f,%.0f,%.1f\n",
+                     static_cast<long long>(std::time(nullptr)), label ? label : "",
+                     r.simulated_s, r.wall_s, static_cast<unsigned long long>(r.steps),
+                     static_cast<unsigned long long>(r.events), r.StepsPerSec(), r.EventsPerSec(), r.RealTime());
+        return std::fclose(file) == 0;
+    }
+
+    void Usage(const char* argv0){
+        std::fprintf(stderr,
+            "usage: %s [--sim <RasterDriverSim>] [--repeat <n>] [--csv <history>] [--label <commit>]\n"
+            "          [--max-slowdown <fraction>]\n", argv0);
+        std::exit(2);
+    }
+
+    Options Parse(int argc, char** argv){
+        Options opt;
+        std::string self{argv[0]};
+        auto slash = self.rfind('/');
+        opt.sim = (slash == std::string::npos ? std::string{"."} : self.substr(0, slash)) + "/RasterDriverSim";
+        for(int i = 1; i < argc; i++){
+            std::string_view arg{argv[i]};
+            if(i + 1 == argc)
+                Usage(argv[0]);
+            auto value = argv[++i];
+            if(arg == "--sim")
+                opt.sim = value;
+            else if(arg == "--repeat")
+                opt.repeat = std::max(1ul, std::strtoul(value, nullptr, 10));
+            else if(arg == "--csv")
+                opt.csv = value;
+            else if(arg == "--label")
+                opt.label = value;
+            else if(arg == "--max-slowdown")
+                opt.max_slowdown = std::strtod(value, nullptr);
+            else
+                Usage(argv[0]);
+        }
+        return opt;
+    }
+}
+
+int main(int argc, char** argv){
+    auto opt = Parse(argc, argv);
+    auto scenario = MakeScenario();
+
+    Result best;
+    for(uint32_t i = 0; i < opt.repeat; i++){
+        Result result;
+        if(!Run(opt, scenario, result)){
+            std::fprintf(stderr, "sim_bench: %s failed\n", opt.sim.c_str());
+            return EXIT_FAILURE;
+        }
+        if(!best.wall_s || result.wall_s < best.wall_s)
+            best = result;
+    }
+
+    std::printf("scenario     %u exposures, %.1f s simulated\n", kExposures, best.simulated_s);
+    std::printf("wall         %.4f s (best of %u)\n", best.wall_s, opt.repeat);
+    std::printf("steps        %llu, %.0f /s\n", static_cast<unsigned long long>(best.steps), best.StepsPerSec());
+    std::printf("events       %llu, %.0f /s\n", static_cast<unsigned long long>(best.events), best.EventsPerSec());
+    std::printf("real time    %.0fx\n", best.RealTime());
+
+    if(!opt.csv)
+        return EXIT_SUCCESS;
+    double previous = 0;
+    bool has_previous = LastStepsPerSec(opt.csv, previous);
+    if(!AppendCsv(opt.csv, opt.label, best)){
+        std::fprintf(stderr, "sim_bench: cannot write %s\n", opt.csv);
+        return EXIT_FAILURE;
+    }
+    if(has_previous && previous > 0){
+        auto change = best.StepsPerSec() / previous - 1;
+        std::printf("vs previous  %+.1f %%\n", change * 100);
+        if(opt.max_slowdown >= 0 && change < -opt.max_slowdown){
+            std::fprintf(stderr, "sim_bench: steps/s %.1f %% below the previous run in %s\n", -change * 100, opt.csv);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+// RasterDriverTraceDiff: compares two step traces (see app/step_trace.hpp) step by step and
+// reports timing deviation, velocity error, total move time change and state differences.
+// Exits with 1 when the traces differ by more than the tolerance, e.g. against a golden trace.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+#include "trace_file.hpp"
+
+namespace{
+    struct Trace{
+        std::vector<StepTrace::Record> steps;
+        std::vector<StepTrace::Record> events;
+    };
+
+    bool Load(const char* path, Trace& trace){
+        sim::MappedFile file{path};
+        if(!file.IsOpen()){
+            std::fprintf(stderr, "trace_diff: cannot open %s\n", path);
+            return false;
+        }
+        auto decoder = file.Decoder();
+        StepTrace::Record record{};
+        while(decoder.Next(record))
+            (record.kind == StepTrace::Kind::step ? trace.steps : trace.events).push_back(record);
+        if(!decoder.IsValid()){
+            std::fprintf(stderr, "trace_diff: %s is not a step trace or is truncated\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    // steps per second from the period ending at step idx
+    double Velocity(const std::vector<StepTrace::Record>& steps, std::size_t idx){
+        if(idx == 0)
+            return 0;
+        return 1e9 / static_cast<double>(steps[idx].time - steps[idx - 1].time);
+    }
+
+    int64_t MoveTime(const std::vector<StepTrace::Record>& steps){
+        return steps.empty() ? 0 : static_cast<int64_t>(steps.back().time - steps.front().time);
+    }
+
+    void Usage(const char* argv0){
+        std::fprintf(stderr,
+            "usage: %s [--tolerance <ns>] [--align] [--verbose] <reference> <trace>\n"
+            "  --align    compare times relative to the first step of each trace\n", argv0);
+        std::exit(2);
+    }
+}
+
+int main(int argc, char** argv){
+    int64_t tolerance = 0;
+    bool align = false;
+    bool verbose = false;
+    std::vector<const char*> paths;
+    for(int i = 1; i < argc; i++){
+        std::string_view arg{argv[i]};
+        if(arg == "--tolerance" && i + 1 < argc)
+            tolerance = std::strtoll(argv[++i], nullptr, 10);
+        else if(arg == "--align")
+            align = true;
+        else if(arg == "--verbose")
+            verbose = true;
+        else if(!arg.starts_with("--"))
+            paths.push_back(argv[i]);
+        else
+            Usage(argv[0]);
+    }
+    if(paths.size() != 2)
+        Usage(argv[0]);
+
+    Trace a, b;
+    if(!Load(paths[0], a) || !Load(paths[1], b))
+        return 2;
+
+    bool differs = a.steps.size() != b.steps.size();
+    std::printf("steps:       %zu -> %zu\n", a.steps.size(), b.steps.size());
+
+    auto common = std::min(a.steps.size(), b.steps.size());
+    int64_t offset = 0;
+    if(align && common)
+        offset = static_cast<int64_t>(b.steps.front().time) - static_cast<int64_t>(a.steps.front().time);
+
+    int64_t max_dev = 0;
+    std::size_t max_dev_idx = 0;
+    double sum_dev = 0;
+    double max_vel_err = 0;
+    std::size_t max_vel_idx = 0;
+    std::size_t dir_mismatches = 0;
+    std::size_t over_tolerance = 0;
+    for(std::size_t i = 0; i < common; i++){
+        auto dev = static_cast<int64_t>(b.steps[i].time - a.steps[i].time) - offset;
+        if(std::llabs(dev) > std::llabs(max_dev)){
+            max_dev = dev;
+            max_dev_idx = i;
+        }
+        sum_dev += static_cast<double>(std::llabs(dev));
+        auto vel_err = Velocity(b.steps, i) - Velocity(a.steps, i);
+        if(std::fabs(vel_err) > std::fabs(max_vel_err)){
+            max_vel_err = vel_err;
+            max_vel_idx = i;
+        }
+        if(a.steps[i].dir != b.steps[i].dir)
+            dir_mismatches++;
+        if(std::llabs(dev) > tolerance){
+            if(verbose)
+                std::printf("  step %zu: %llu -> %llu (%+lld ns)\n", i,
+                            static_cast<unsigned long long>(a.steps[i].time),
+                            static_cast<unsigned long long>(b.steps[i].time), static_cast<long long>(dev));
+            over_tolerance++;
+        }
+    }
+    differs |= over_tolerance || dir_mismatches;
+
+    std::printf("timing:      max %+lld ns at step %zu, mean |dev| %.1f ns, %zu steps over %lld ns\n",
+                static_cast<long long>(max_dev), max_dev_idx, common ? sum_dev / static_cast<double>(common) : 0.0,
+                over_tolerance, static_cast<long long>(tolerance));
+    std::printf("velocity:    max error %+.3f steps/s at step %zu\n", max_vel_err, max_vel_idx);
+    auto move_a = MoveTime(a.steps);
+    auto move_b = MoveTime(b.steps);
+    std::printf("move time:   %lld -> %lld ns (%+lld ns)\n", static_cast<long long>(move_a),
+                static_cast<long long>(move_b), static_cast<long long>(move_b - move_a));
+    std::printf("direction:   %zu mismatches\n", dir_mismatches);
+
+    // the state sequence has to match, its timing follows the steps
+    std::size_t event_mismatches = a.events.size() > b.events.size() ? a.events.size() - b.events.size()
+                                                                      : b.events.size() - a.events.size();
+    for(std::size_t i = 0; i < std::min(a.events.size(), b.events.size()); i++){
+        auto& ea = a.events[i];
+        auto& eb = b.events[i];
+        if(ea.kind == eb.kind && ea.index == eb.index && ea.value == eb.value)
+            continue;
+        if(verbose)
+            std::printf("  event %zu: kind %u index %u value %ld -> kind %u index %u value %ld\n", i,
+                        static_cast<unsigned>(ea.kind), ea.index, static_cast<long>(ea.value),
+                        static_cast<unsigned>(eb.kind), eb.index, static_cast<long>(eb.value));
+        event_mismatches++;
+    }
+    differs |= event_mismatches != 0;
+    std::printf("events:      %zu -> %zu, %zu mismatches\n", a.events.size(), b.events.size(), event_mismatches);
+
+    std::printf("%s\n", differs ? "DIFFERENT" : "MATCH");
+    return differs ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "step_trace.hpp"
+
+namespace sim{
+
+// read only view of a whole file, traces are decoded in place
+class MappedFile{
+public:
+    explicit MappedFile(const char* path){
+        int fd = open(path, O_RDONLY);
+        if(fd < 0)
+            return;
+        struct stat st{};
+        if(fstat(fd, &st) == 0 && st.st_size > 0){
+            auto data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data != MAP_FAILED){
+                data_ = static_cast<const uint8_t*>(data);
+                size_ = static_cast<std::size_t>(st.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile(){
+        if(data_)
+            munmap(const_cast<uint8_t*>(data_), size_);
+    }
+
+    [[nodiscard]] bool IsOpen() const{ return data_ != nullptr; }
+    [[nodiscard]] const uint8_t* Data() const{ return data_; }
+    [[nodiscard]] std::size_t Size() const{ return size_; }
+
+    [[nodiscard]] StepTraceDecoder Decoder() const{
+        return {data_, size_};
+    }
+
+private:
+    const uint8_t* data_ {nullptr};
+    std::size_t size_ {0};
+};
+
+// StepTraceEncoder into a file, the buffer is written out whenever it fills up
+class StepTraceFile{
+public:
+    bool Open(const char* path, uint64_t start_time){
+        file_ = std::fopen(path, "wb");
+        return file_ && encoder_.Begin(start_time);
+    }
+
+    ~StepTraceFile(){
+        if(!file_)
+            return;
+        Flush();
+        std::fclose(file_);
+    }
+
+    void Step(uint64_t time, bool forward){
+        if(file_ && !encoder_.Step(time, forward)){
+            Flush();
+            encoder_.Step(time, forward);
+        }
+    }
+
+    void Event(StepTrace::Kind kind, uint64_t time, uint32_t index, int32_t value){
+        if(file_ && !encoder_.Event(kind, time, index, value)){
+            Flush();
+            encoder_.Event(kind, time, index, value);
+        }
+    }
+
+private:
+    void Flush(){
+        std::fwrite(buffer_.data(), 1, encoder_.Size(), file_);
+        encoder_.Drain();
+    }
+
+    std::FILE* file_ {nullptr};
+    std::array<uint8_t, 4096> buffer_ {};
+    StepTraceEncoder encoder_ {buffer_.data(), buffer_.size()};
+};
+
+}
@@ -0,0 +1,8 @@
+#include <cstdio>
+#include <cstdlib>
+
+// called by the CubeMX init code of the sim board model on a HAL error
+extern "C" void Error_Handler(void){
+    std::fprintf(stderr, "RasterDriverTest: Error_Handler\n");
+    std::abort();
+}
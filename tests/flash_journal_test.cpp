@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "flash_journal.hpp"
+#include "test_board.hpp"
+
+namespace{
+    constexpr uint32_t kEntries = FLASH_PAGE_SIZE / sizeof(uint64_t);
+}
+
+class FlashJournalTest : public testing::Test{
+protected:
+    void SetUp() override{
+        MapTestFlash();
+        EraseTestPage(_sjournal);
+    }
+
+    FlashJournal journal_;
+};
+
+TEST_F(FlashJournalTest, ErasedPageHasNoValues){
+    for(uint8_t key = 0; key < FlashJournal::kMaxKeys; key++)
+        EXPECT_FALSE(journal_.Read(key));
+    EXPECT_FALSE(journal_.IsFull());
+}
+
+TEST_F(FlashJournalTest, ReadsTheLatestValuePerKey){
+    EXPECT_TRUE(journal_.Append(1, 10));
+    EXPECT_TRUE(journal_.Append(2, 20));
+    EXPECT_TRUE(journal_.Append(1, 11));
+    EXPECT_EQ(journal_.Read(1), 11u);
+    EXPECT_EQ(journal_.Read(2), 20u);
+    EXPECT_FALSE(journal_.Read(3));
+}
+
+TEST_F(FlashJournalTest, RejectsKeysOutOfRange){
+    EXPECT_FALSE(journal_.Append(FlashJournal::kMaxKeys, 1));
+    EXPECT_FALSE(journal_.Append(0xFF, 1));
+}
+
+TEST_F(FlashJournalTest, UnchangedValueIsNotProgrammed){
+    for(uint32_t i = 0; i < 2 * kEntries; i++)
+        EXPECT_TRUE(journal_.Append(0, 7));
+    EXPECT_FALSE(journal_.IsFull());
+    auto second = reinterpret_cast<const uint8_t*>(_sjournal) + sizeof(uint64_t);
+    EXPECT_EQ(*second, 0xFF);
+}
+
+TEST_F(FlashJournalTest, EntryWithBadCheckIsIgnored){
+    EXPECT_TRUE(journal_.Append(4, 40));
+    EXPECT_TRUE(journal_.Append(4, 41));
+    // check byte of the second entry
+    reinterpret_cast<uint8_t*>(_sjournal)[sizeof(uint64_t) + 1] ^= 0x01;
+    EXPECT_EQ(journal_.Read(4), 40u);
+}
+
+TEST_F(FlashJournalTest, FullPageIsCompactedToTheLatestValues){
+    EXPECT_TRUE(journal_.Append(3, 300));
+    EXPECT_TRUE(journal_.Append(6, 600));
+    for(uint32_t value = 1; !journal_.IsFull(); value++)
+        ASSERT_TRUE(journal_.Append(5, value));
+    auto last = *journal_.Read(5);
+    EXPECT_EQ(last, kEntries - 2);
+
+    EXPECT_TRUE(journal_.Append(5, last + 1));
+    EXPECT_FALSE(journal_.IsFull());
+    EXPECT_EQ(journal_.Read(3), 300u);
+    EXPECT_EQ(journal_.Read(6), 600u);
+    EXPECT_EQ(journal_.Read(5), last + 1);
+    // the compacted page holds one entry per key plus the new one
+    auto entries = reinterpret_cast<const uint64_t*>(_sjournal);
+    EXPECT_NE(entries[3], UINT64_MAX);
+    EXPECT_EQ(entries[4], UINT64_MAX);
+}
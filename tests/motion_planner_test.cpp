@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "motion_planner.hpp"
+
+TEST(MotionPlanner, MeasuresTimeToRequiredSpeed){
+    MotionPlanner planner;
+    EXPECT_FALSE(planner.CruiseTime());
+    EXPECT_FALSE(planner.CruiseSteps());
+    planner.RampStarted(1000);
+    EXPECT_FALSE(planner.RampStep(1500, 40, false));
+    EXPECT_TRUE(planner.RampStep(1900, 64, true));
+    // reported once per ramp
+    EXPECT_FALSE(planner.RampStep(2000, 65, true));
+    ASSERT_TRUE(planner.CruiseTime());
+    EXPECT_EQ(*planner.CruiseTime(), 900u);
+    ASSERT_TRUE(planner.CruiseSteps());
+    EXPECT_EQ(*planner.CruiseSteps(), 64u);
+    EXPECT_EQ(*planner.CruiseTimestamp(5000, 100), 5800u);
+    // a lead longer than the ramp predicts the ramp start
+    EXPECT_EQ(*planner.CruiseTimestamp(5000, 2000), 5000u);
+}
+
+TEST(MotionPlanner, InvalidateDropsTheMeasurement){
+    MotionPlanner planner;
+    planner.RampStarted(0);
+    planner.RampStep(100, 10, true);
+    planner.Invalidate();
+    EXPECT_FALSE(planner.CruiseTime());
+    EXPECT_FALSE(planner.CruiseSteps());
+    EXPECT_FALSE(planner.CruiseTimestamp(0, 0));
+    EXPECT_FALSE(planner.RampStep(200, 20, true));
+}
+
+TEST(MotionPlanner, SkippedMoveKeepsTheMeasurement){
+    MotionPlanner planner;
+    planner.RampStarted(0);
+    planner.RampStep(100, 10, true);
+    planner.RampStarted(1000);
+    planner.RampSkipped();
+    EXPECT_FALSE(planner.RampStep(1500, 30, true));
+    ASSERT_TRUE(planner.CruiseSteps());
+    EXPECT_EQ(*planner.CruiseSteps(), 10u);
+}
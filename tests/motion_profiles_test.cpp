@@ -0,0 +1,156 @@
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "motion_profiles.hpp"
+#include "test_board.hpp"
+
+namespace{
+    MotionProfile ValidProfile(){
+        return ProfileTable::Defaults().profiles[0];
+    }
+}
+
+TEST(ProfileTable, Crc32MatchesTheReferenceValue){
+    constexpr char kCheck[] = "123456789";
+    EXPECT_EQ(ProfileTable::Crc32(kCheck, 9), 0xCBF43926u);
+}
+
+TEST(ProfileTable, DefaultsAreValid){
+    auto table = ProfileTable::Defaults();
+    EXPECT_TRUE(table.IsValid());
+    for(uint8_t idx = 0; idx < table.count; idx++)
+        EXPECT_TRUE(table.profiles[idx].IsValid()) << static_cast<int>(idx);
+}
+
+TEST(ProfileTable, CrcCoversEveryProfileByte){
+    auto reference = ProfileTable::Defaults();
+    for(std::size_t offset = 0; offset < sizeof(reference.profiles); offset++){
+        auto table = reference;
+        reinterpret_cast<uint8_t*>(table.profiles.data())[offset] ^= 0x01;
+        EXPECT_FALSE(table.IsValid()) << offset;
+    }
+}
+
+TEST(ProfileTable, RejectsForeignHeaders){
+    auto table = ProfileTable::Defaults();
+    table.version++;
+    table.crc = table.CalcCrc();
+    EXPECT_FALSE(table.IsValid());
+
+    table = ProfileTable::Defaults();
+    table.magic = 0;
+    table.crc = table.CalcCrc();
+    EXPECT_FALSE(table.IsValid());
+
+    table = ProfileTable::Defaults();
+    table.count = 0;
+    table.crc = table.CalcCrc();
+    EXPECT_FALSE(table.IsValid());
+
+    table = ProfileTable::Defaults();
+    table.count = ProfileTable::kMaxProfiles + 1;
+    table.crc = table.CalcCrc();
+    EXPECT_FALSE(table.IsValid());
+}
+
+TEST(MotionProfile, RejectsOutOfRangeParameters){
+    EXPECT_TRUE(ValidProfile().IsValid());
+
+    auto profile = ValidProfile();
+    profile.A = 0;
+    EXPECT_FALSE(profile.IsValid());
+    profile.A = -1;
+    EXPECT_FALSE(profile.IsValid());
+
+    profile = ValidProfile();
+    profile.Vmin = 0;
+    EXPECT_FALSE(profile.IsValid());
+
+    profile = ValidProfile();
+    profile.Vmax = profile.Vmin;
+    EXPECT_FALSE(profile.IsValid());
+
+    profile = ValidProfile();
+    profile.Vmax = PROFILE_MAX_SPEED + 1;
+    EXPECT_FALSE(profile.IsValid());
+
+    profile = ValidProfile();
+    profile.ramp_time = 0;
+    EXPECT_FALSE(profile.IsValid());
+
+    profile = ValidProfile();
+    profile.accel_type = utils::get_idx(MotorSpecial::AccelType::kSigmoid) + 1;
+    EXPECT_FALSE(profile.IsValid());
+}
+
+class ProfileStoreTest : public testing::Test{
+protected:
+    void SetUp() override{
+        MapTestFlash();
+        EraseTestPage(_sprofiles);
+    }
+
+    static void StoreTable(const ProfileTable& table){
+        std::memcpy(_sprofiles, &table, sizeof(table));
+    }
+};
+
+TEST_F(ProfileStoreTest, BlankPageLoadsTheDefaults){
+    ProfileStore store;
+    store.Load();
+    EXPECT_EQ(store.Count(), ProfileTable::Defaults().count);
+    EXPECT_EQ(store.Get(store.Count()), nullptr);
+}
+
+TEST_F(ProfileStoreTest, LoadsAValidTable){
+    auto table = ProfileTable::Defaults();
+    table.count = 1;
+    table.profiles[0].Vmax = PROFILE_MAX_SPEED;
+    table.crc = table.CalcCrc();
+    StoreTable(table);
+
+    ProfileStore store;
+    store.Load();
+    ASSERT_EQ(store.Count(), 1);
+    EXPECT_FLOAT_EQ(store.Get(0)->Vmax, PROFILE_MAX_SPEED);
+}
+
+TEST_F(ProfileStoreTest, CorruptedTableFallsBackToTheDefaults){
+    auto table = ProfileTable::Defaults();
+    table.count = 1;
+    table.crc = table.CalcCrc();
+    table.profiles[0].Vmax += 1;
+    StoreTable(table);
+
+    ProfileStore store;
+    store.Load();
+    EXPECT_EQ(store.Count(), ProfileTable::Defaults().count);
+}
+
+TEST_F(ProfileStoreTest, BufferSwapsInOnlyPreparedValidProfiles){
+    ProfileStore store;
+    store.Load();
+    ProfileBuffer buffer;
+    EXPECT_EQ(buffer.Swap(), nullptr);
+
+    buffer.Request(2);
+    EXPECT_EQ(buffer.Swap(), nullptr);
+    buffer.Prepare(store);
+    auto slot = buffer.Swap();
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->idx, 2);
+    EXPECT_FLOAT_EQ(slot->cfg.accelCfg.Vmax, store.Get(2)->Vmax);
+    EXPECT_EQ(buffer.ActiveIdx(), 2);
+    EXPECT_EQ(buffer.Swap(), nullptr);
+
+    // the active profile is not staged again
+    buffer.Request(2);
+    buffer.Prepare(store);
+    EXPECT_EQ(buffer.Swap(), nullptr);
+
+    buffer.Request(ProfileTable::kMaxProfiles);
+    buffer.Prepare(store);
+    EXPECT_EQ(buffer.Swap(), nullptr);
+    EXPECT_EQ(buffer.ActiveIdx(), 2);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include "machine.hpp"
+#include "port_io.hpp"
+
+namespace{
+    constexpr uint32_t kBit = 1u << 3;
+    constexpr uint32_t kSamplesToToggle = 4;
+}
+
+TEST(VerticalDebouncer, TogglesAfterFourEqualSamples){
+    VerticalDebouncer debouncer;
+    debouncer.Reset(0);
+    for(uint32_t i = 1; i < kSamplesToToggle; i++)
+        EXPECT_EQ(debouncer.Update(kBit), 0u) << i;
+    EXPECT_EQ(debouncer.Update(kBit), kBit);
+    EXPECT_EQ(debouncer.State(), kBit);
+    // reported once
+    EXPECT_EQ(debouncer.Update(kBit), 0u);
+}
+
+TEST(VerticalDebouncer, GlitchRestartsTheCount){
+    VerticalDebouncer debouncer;
+    debouncer.Reset(kBit);
+    for(int burst = 0; burst < 8; burst++){
+        for(uint32_t i = 1; i < kSamplesToToggle; i++)
+            EXPECT_EQ(debouncer.Update(0), 0u);
+        EXPECT_EQ(debouncer.Update(kBit), 0u);
+    }
+    EXPECT_EQ(debouncer.State(), kBit);
+}
+
+TEST(VerticalDebouncer, BitsAreIndependent){
+    constexpr uint32_t kOther = 1u << 17;
+    VerticalDebouncer debouncer;
+    debouncer.Reset(kOther);
+    debouncer.Update(kBit | kOther);
+    debouncer.Update(kBit);
+    debouncer.Update(kBit);
+    // kOther has seen three of its four samples
+    EXPECT_EQ(debouncer.Update(kBit), kBit);
+    EXPECT_EQ(debouncer.State(), kBit | kOther);
+    EXPECT_EQ(debouncer.Update(kBit), kOther);
+    EXPECT_EQ(debouncer.State(), kBit);
+}
+
+class PortInputsTest : public testing::Test{
+protected:
+    void SetUp() override{
+        SetPin(PortInputs::kFastMask | PortInputs::kDipMask, false);
+        inputs_.Init();
+    }
+
+    static void SetPin(uint32_t pins, bool level){
+        sim::Machine::Get().SetInput(GPIOA, static_cast<uint16_t>(pins), level);
+    }
+
+    // control ticks until mask changes, 0 when it did not within max_ticks
+    uint32_t TicksToChange(uint32_t mask, uint32_t max_ticks){
+        for(uint32_t tick = 1; tick <= max_ticks; tick++){
+            inputs_.Update();
+            if(inputs_.Changed(mask))
+                return tick;
+        }
+        return 0;
+    }
+
+    PortInputs inputs_;
+};
+
+TEST_F(PortInputsTest, FastInputsSettleInFourTicks){
+    SetPin(GRID_HOME_DETECT_Pin, true);
+    EXPECT_EQ(TicksToChange(GRID_HOME_DETECT_Pin, 100), kSamplesToToggle);
+    EXPECT_TRUE(inputs_.Rise() & GRID_HOME_DETECT_Pin);
+    EXPECT_TRUE(inputs_.IsHigh(GRID_HOME_DETECT_Pin));
+
+    SetPin(GRID_HOME_DETECT_Pin, false);
+    EXPECT_EQ(TicksToChange(GRID_HOME_DETECT_Pin, 100), kSamplesToToggle);
+    EXPECT_TRUE(inputs_.Fall() & GRID_HOME_DETECT_Pin);
+}
+
+TEST_F(PortInputsTest, DipSwitchesSettleInDebounceTicks){
+    SetPin(CONFIG_2_Pin, true);
+    auto ticks = TicksToChange(PortInputs::kDipMask, 10 * DIP_DEBOUNCE_TICKS);
+    EXPECT_GE(ticks, DIP_DEBOUNCE_TICKS);
+    EXPECT_LT(ticks, DIP_DEBOUNCE_TICKS + 2 * kSamplesToToggle);
+    EXPECT_TRUE(inputs_.IsHigh(CONFIG_2_Pin));
+}
+
+TEST_F(PortInputsTest, InvertedInputsAreActiveLow){
+    inputs_.SetInverted(EXP_REQ_IN_Pin);
+    inputs_.Init();
+    EXPECT_TRUE(inputs_.IsHigh(EXP_REQ_IN_Pin));
+    SetPin(EXP_REQ_IN_Pin, true);
+    EXPECT_EQ(TicksToChange(EXP_REQ_IN_Pin, 100), kSamplesToToggle);
+    EXPECT_FALSE(inputs_.IsHigh(EXP_REQ_IN_Pin));
+    EXPECT_TRUE(inputs_.Raw() & EXP_REQ_IN_Pin);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "machine.hpp"
+
+// Emulated flash of the sim board model, erased and mapped once per test process at
+// FLASH_BASE, where the linker script symbols of the sim builds point
+inline void MapTestFlash(){
+    static bool mapped = sim::Machine::Get().MapFlash(nullptr);
+    ASSERT_TRUE(mapped);
+}
+
+inline void EraseTestPage(const void* page){
+    std::memset(const_cast<void*>(page), 0xFF, FLASH_PAGE_SIZE);
+}